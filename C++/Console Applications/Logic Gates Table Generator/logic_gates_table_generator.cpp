@@ -17,31 +17,39 @@
  #include <iomanip>
  #include <algorithm>
  #include <limits>
+ #include "../../headers/custom/terminal/terminal.h"
  
  using namespace std;
  
+ /**
+  * @brief Buffered terminal output shared with the other console applications
+  * Everything printed goes into one buffer that is written with a single system call
+  * before each prompt; escape codes are only sent for color changes that reach the
+  * screen, and none at all when output is redirected.
+  */
+ terminal::Output& term = terminal::out();
+
  /**
   * @brief ANSI Color codes for terminal output styling
   * These constants define the color codes used for terminal text formatting
   */
- const string RESET = "\033[0m";     // Reset all formatting
- const string BOLD = "\033[1m";      // Bold text
- const string RED = "\033[31m";      // Error messages and '0' values
- const string GREEN = "\033[32m";     // Success messages and '1' values
- const string YELLOW = "\033[33m";    // Warnings and headers
- const string BLUE = "\033[34m";      // Information and prompts
- const string MAGENTA = "\033[35m";   // Titles
- const string CYAN = "\033[36m";      // Borders and structure
- const string WHITE = "\033[37m";     // Regular text
+ const terminal::Style RESET = terminal::Style::Reset;       // Reset all formatting
+ const terminal::Style BOLD = terminal::Style::Bold;         // Bold text
+ const terminal::Color RED = terminal::Color::Red;           // Error messages and '0' values
+ const terminal::Color GREEN = terminal::Color::Green;       // Success messages and '1' values
+ const terminal::Color YELLOW = terminal::Color::Yellow;     // Warnings and headers
+ const terminal::Color BLUE = terminal::Color::Blue;         // Information and prompts
+ const terminal::Color MAGENTA = terminal::Color::Magenta;   // Titles
+ const terminal::Color CYAN = terminal::Color::Cyan;         // Borders and structure
+ const terminal::Color WHITE = terminal::Color::White;       // Regular text
  
  /**
   * @brief Enables ANSI color support in Windows terminal
-  * This function ensures color codes work properly in Windows Command Prompt
+  * The terminal writer switches the Windows console into virtual terminal mode when it
+  * is created, so all that is left is making sure it exists before the first output
   */
  void enableColors() {
-     #ifdef _WIN32
-         system("color");
-     #endif
+     (void)terminal::out();
  }
  
  /**
@@ -115,6 +123,7 @@
  * Cross-platform function to clear terminal output
  */
 void clearScreen() {
+    term.flush();
     #ifdef _WIN32
         system("cls");
     #else
@@ -152,77 +161,77 @@ void displayTable(const vector<vector<int>>& combinations,
         return string(leftPad, ' ') + text + string(rightPad, ' ');
     };
 
-    cout << "\n";
+    term << "\n";
     
     // Title section for larger tables
     if (numInputs >= 4) {
-        cout << CYAN << "+" << string(totalWidth, '=') << "+" << RESET << "\n";
+        term << CYAN << "+" << string(totalWidth, '=') << "+" << RESET << "\n";
         string title = gate + " Gate Truth Table (" + to_string(numInputs) + " inputs)";
-        cout << CYAN << "|" << MAGENTA << BOLD << centerText(title, totalWidth) 
+        term << CYAN << "|" << MAGENTA << BOLD << centerText(title, totalWidth) 
              << CYAN << "|" << RESET << "\n";
-        cout << CYAN << "+" << string(totalWidth, '=') << "+" << RESET << "\n";
+        term << CYAN << "+" << string(totalWidth, '=') << "+" << RESET << "\n";
     }
 
     // Table header
-    cout << CYAN << "+" << string(totalWidth, '=') << "+" << RESET << "\n";
-    cout << CYAN << "| " << YELLOW << BOLD << centerText("INPUTS", inputWidth-1) 
+    term << CYAN << "+" << string(totalWidth, '=') << "+" << RESET << "\n";
+    term << CYAN << "| " << YELLOW << BOLD << centerText("INPUTS", inputWidth-1) 
          << CYAN << "||" << YELLOW << BOLD << "  OUTPUT " << CYAN << "|" << RESET << "\n";
 
     // Column headers
-    cout << CYAN << "+";
+    term << CYAN << "+";
     for (int i = 0; i < numInputs; i++) {
-        cout << string(columnWidth, '=');
-        if (i < numInputs - 1) cout << "+";
+        term << string(columnWidth, '=');
+        if (i < numInputs - 1) term << "+";
     }
-    cout << "++" << string(outputWidth + 1, '=') << "+" << RESET << "\n";
+    term << "++" << string(outputWidth + 1, '=') << "+" << RESET << "\n";
 
-    cout << CYAN << "|";
+    term << CYAN << "|";
     for (int i = 0; i < numInputs; i++) {
         string header = " A" + to_string(i) + " ";
-        cout << BLUE << BOLD << centerText(header, columnWidth) << CYAN << "|";
+        term << BLUE << BOLD << centerText(header, columnWidth) << CYAN << "|";
     }
-    cout << "|" << BLUE << BOLD << "   OUT   " << CYAN << "|" << RESET << "\n";
+    term << "|" << BLUE << BOLD << "   OUT   " << CYAN << "|" << RESET << "\n";
 
     // Separator
-    cout << CYAN << "+";
+    term << CYAN << "+";
     for (int i = 0; i < numInputs; i++) {
-        cout << string(columnWidth, '=');
-        if (i < numInputs - 1) cout << "+";
+        term << string(columnWidth, '=');
+        if (i < numInputs - 1) term << "+";
     }
-    cout << "++" << string(outputWidth + 1, '=') << "+" << RESET << "\n";
+    term << "++" << string(outputWidth + 1, '=') << "+" << RESET << "\n";
 
     // Table content
     for (size_t i = 0; i < combinations.size(); ++i) {
         // Input values
-        cout << CYAN << "|";
+        term << CYAN << "|";
         for (int j = 0; j < numInputs; j++) {
             string value = " " + to_string(combinations[i][j]) + " ";
-            cout << (combinations[i][j] ? GREEN : RED) << BOLD 
+            term << (combinations[i][j] ? GREEN : RED) << BOLD 
                  << centerText(value, columnWidth) << CYAN << "|";
         }
         
         // Output value
-        cout << "|" << (outputs[i] ? GREEN : RED) << BOLD 
+        term << "|" << (outputs[i] ? GREEN : RED) << BOLD 
              << "    " << outputs[i] << "    " << CYAN << "|" << RESET << "\n";
 
         // Row separator
         if (i < combinations.size() - 1) {
-            cout << CYAN << "+";
+            term << CYAN << "+";
             for (int j = 0; j < numInputs; j++) {
-                cout << string(columnWidth, '-');
-                if (j < numInputs - 1) cout << "+";
+                term << string(columnWidth, '-');
+                if (j < numInputs - 1) term << "+";
             }
-            cout << "++" << string(outputWidth + 1, '-') << "+" << RESET << "\n";
+            term << "++" << string(outputWidth + 1, '-') << "+" << RESET << "\n";
         }
     }
 
     // Bottom border
-    cout << CYAN << "+";
+    term << CYAN << "+";
     for (int i = 0; i < numInputs; i++) {
-        cout << string(columnWidth, '=');
-        if (i < numInputs - 1) cout << "+";
+        term << string(columnWidth, '=');
+        if (i < numInputs - 1) term << "+";
     }
-    cout << "++" << string(outputWidth + 1, '=') << "+" << RESET << "\n\n";
+    term << "++" << string(outputWidth + 1, '=') << "+" << RESET << "\n\n";
 }
 /**
  * @brief Displays the help menu with available commands
@@ -233,71 +242,71 @@ void displayTable(const vector<vector<int>>& combinations,
     const int width = 45;  // Reduced width to prevent overflow
 
     // Title section
-    cout << "\n" << CYAN << "+" << string(width, '=') << "+" << RESET << "\n";
-    cout << CYAN << "|" << MAGENTA << BOLD 
+    term << "\n" << CYAN << "+" << string(width, '=') << "+" << RESET << "\n";
+    term << CYAN << "|" << MAGENTA << BOLD 
          << "        Logic Gates Command Reference        " 
          << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "+" << string(width, '=') << "+" << RESET << "\n";
+    term << CYAN << "+" << string(width, '=') << "+" << RESET << "\n";
     
     // Commands section header
-    cout << CYAN << "|" << YELLOW << BOLD << " Available Commands" 
+    term << CYAN << "|" << YELLOW << BOLD << " Available Commands" 
          << string(26, ' ') << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
+    term << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
     
     // Basic Gates
-    cout << CYAN << "| " << BLUE << BOLD << "OR" << WHITE << " [num_inputs]" 
+    term << CYAN << "| " << BLUE << BOLD << "OR" << WHITE << " [num_inputs]" 
          << string(3, ' ') << GREEN << "->" << string(1, ' ')
          << WHITE << "Display OR gate table  " << CYAN << "|" << RESET << "\n";
     
-    cout << CYAN << "| " << BLUE << BOLD << "AND" << WHITE << " [num_inputs]" 
+    term << CYAN << "| " << BLUE << BOLD << "AND" << WHITE << " [num_inputs]" 
          << string(2, ' ') << GREEN << "->" << string(1, ' ')
          << WHITE << "Display AND gate table " << CYAN << "|" << RESET << "\n";
     
-    cout << CYAN << "| " << BLUE << BOLD << "NOT" << string(15, ' ')
+    term << CYAN << "| " << BLUE << BOLD << "NOT" << string(15, ' ')
          << GREEN << "->" << string(1, ' ')
          << WHITE << "Display NOT gate table " << CYAN << "|" << RESET << "\n";
 
     // Complex Gates
-    cout << CYAN << "| " << BLUE << BOLD << "NAND" << WHITE << " [num_inputs] "
+    term << CYAN << "| " << BLUE << BOLD << "NAND" << WHITE << " [num_inputs] "
          << GREEN << "->" << string(1, ' ')
          << WHITE << "Display NAND gate table" << CYAN << "|" << RESET << "\n";
 
-    cout << CYAN << "| " << BLUE << BOLD << "NOR" << WHITE << " [num_inputs]"
+    term << CYAN << "| " << BLUE << BOLD << "NOR" << WHITE << " [num_inputs]"
          << string(2, ' ') << GREEN << "->" << string(1, ' ')
          << WHITE << "Display NOR gate table " << CYAN << "|" << RESET << "\n";
 
-    cout << CYAN << "| " << BLUE << BOLD << "XOR" << WHITE << " [num_inputs]"
+    term << CYAN << "| " << BLUE << BOLD << "XOR" << WHITE << " [num_inputs]"
          << string(2, ' ') << GREEN << "->" << string(1, ' ')
          << WHITE << "Display XOR gate table " << CYAN << "|" << RESET << "\n";
 
-    cout << CYAN << "| " << BLUE << BOLD << "XNOR" << WHITE << " [num_inputs] "
+    term << CYAN << "| " << BLUE << BOLD << "XNOR" << WHITE << " [num_inputs] "
          << GREEN << "->" << string(1, ' ')
          << WHITE << "Display XNOR gate table" << CYAN << "|" << RESET << "\n";
     
     // Utility Commands
-    cout << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
-    cout << CYAN << "| " << YELLOW << BOLD << "Utility Commands" 
+    term << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
+    term << CYAN << "| " << YELLOW << BOLD << "Utility Commands" 
          << string(28, ' ') << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
+    term << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
     
-    cout << CYAN << "| " << BLUE << BOLD << "HELP" << string(14, ' ')
+    term << CYAN << "| " << BLUE << BOLD << "HELP" << string(14, ' ')
          << GREEN << "->" << string(1, ' ')
          << WHITE << "Show this help message " << CYAN << "|" << RESET << "\n";
     
-    cout << CYAN << "| " << BLUE << BOLD << "CLS" << string(15, ' ')
+    term << CYAN << "| " << BLUE << BOLD << "CLS" << string(15, ' ')
          << GREEN << "->" << string(1, ' ')
          << WHITE << "Clear terminal screen  " << CYAN << "|" << RESET << "\n";
     
-    cout << CYAN << "| " << BLUE << BOLD << "EXIT" << string(14, ' ')
+    term << CYAN << "| " << BLUE << BOLD << "EXIT" << string(14, ' ')
          << GREEN << "->" << string(1, ' ')
          << WHITE << "Exit the program       " << CYAN << "|" << RESET << "\n";
          
     // Note section
-    cout << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
-    cout << CYAN << "| " << YELLOW << BOLD << "Note" << RESET << WHITE 
+    term << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
+    term << CYAN << "| " << YELLOW << BOLD << "Note" << RESET << WHITE 
          << ": [num_inputs] is optional (default: 2) " 
          << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "+" << string(width, '=') << "+" << RESET << "\n\n";
+    term << CYAN << "+" << string(width, '=') << "+" << RESET << "\n\n";
 }
 
 /**
@@ -309,64 +318,65 @@ void displayTable(const vector<vector<int>>& combinations,
     const int width = 60;  // Standard width for welcome screen
 
     // Program Title
-    cout << "\n" << CYAN << "+" << string(width, '=') << "+" << RESET << "\n";
-    cout << CYAN << "|" << MAGENTA << BOLD << string((width - 37) / 2, ' ') 
+    term << "\n" << CYAN << "+" << string(width, '=') << "+" << RESET << "\n";
+    term << CYAN << "|" << MAGENTA << BOLD << string((width - 37) / 2, ' ') 
          << "Welcome to Logic Gates Table Generator" << string((width - 37) / 2, ' ') 
          << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "+" << string(width, '=') << "+" << RESET << "\n";
+    term << CYAN << "+" << string(width, '=') << "+" << RESET << "\n";
     
     // Developer Information
-    cout << CYAN << "|" << string(width, ' ') << "|" << RESET << "\n";
-    cout << CYAN << "|" << YELLOW << BOLD << string((width - 12) / 2, ' ') 
+    term << CYAN << "|" << string(width, ' ') << "|" << RESET << "\n";
+    term << CYAN << "|" << YELLOW << BOLD << string((width - 12) / 2, ' ') 
          << "Developed By" << string((width - 12) / 2, ' ') 
          << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "|" << string(width, ' ') << "|" << RESET << "\n";
-    cout << CYAN << "|" << BLUE << BOLD << string((width - 13) / 2, ' ') 
+    term << CYAN << "|" << string(width, ' ') << "|" << RESET << "\n";
+    term << CYAN << "|" << BLUE << BOLD << string((width - 13) / 2, ' ') 
          << "Upendra Shahi" << string((width - 13) / 2 + 1, ' ') 
          << CYAN << "|" << RESET << "\n";
     
     // Features Section
-    cout << CYAN << "|" << string(width, ' ') << "|" << RESET << "\n";
-    cout << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
-    cout << CYAN << "|" << YELLOW << BOLD << string((width - 8) / 2, ' ') 
+    term << CYAN << "|" << string(width, ' ') << "|" << RESET << "\n";
+    term << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
+    term << CYAN << "|" << YELLOW << BOLD << string((width - 8) / 2, ' ') 
          << "Features" << string((width - 8) / 2, ' ') 
          << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
+    term << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
     
     // Available Gates
-    cout << CYAN << "| " << YELLOW << BOLD << "Available Logic Gates:" << RESET 
+    term << CYAN << "| " << YELLOW << BOLD << "Available Logic Gates:" << RESET 
          << string(width - 23, ' ') << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "| " << GREEN << "-> " << WHITE << "Basic Gates: " << BLUE << "AND" << WHITE << ", " 
+    term << CYAN << "| " << GREEN << "-> " << WHITE << "Basic Gates: " << BLUE << "AND" << WHITE << ", " 
          << BLUE << "OR" << WHITE << ", " << BLUE << "NOT" 
          << string(width - 29, ' ') << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "| " << GREEN << "-> " << WHITE << "Complex Gates: " << BLUE << "NAND" << WHITE << ", " 
+    term << CYAN << "| " << GREEN << "-> " << WHITE << "Complex Gates: " << BLUE << "NAND" << WHITE << ", " 
          << BLUE << "NOR" << WHITE << ", " << BLUE << "XOR" << WHITE << ", " 
          << BLUE << "XNOR" << string(width - 39, ' ') << CYAN << "|" << RESET << "\n";
     
     // Program Features
-    cout << CYAN << "| " << YELLOW << BOLD << "Program Features:" << RESET 
+    term << CYAN << "| " << YELLOW << BOLD << "Program Features:" << RESET 
          << string(width - 18, ' ') << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "| " << GREEN << "-> " << RED << "Default: "<< WHITE << "Support for up to 16 inputs per gate" 
+    term << CYAN << "| " << GREEN << "-> " << RED << "Default: "<< WHITE << "Support for up to 16 inputs per gate" 
          << string(width - 49, ' ') << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "| " << GREEN << "-> " << WHITE << "Interactive command-line interface" 
+    term << CYAN << "| " << GREEN << "-> " << WHITE << "Interactive command-line interface" 
          << string(width - 38, ' ') << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "| " << GREEN << "-> " << WHITE << "Colorful truth table visualization" 
+    term << CYAN << "| " << GREEN << "-> " << WHITE << "Colorful truth table visualization" 
          << string(width - 38, ' ') << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "| " << GREEN << "-> " << WHITE << "Real-time output generation" 
+    term << CYAN << "| " << GREEN << "-> " << WHITE << "Real-time output generation" 
          << string(width - 31, ' ') << CYAN << "|" << RESET << "\n";
     
     // Version Information
-    cout << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
-    cout << CYAN << "| " << GREEN << BOLD << "Version 1.0 | First Release: 2025 February 16" 
+    term << CYAN << "+" << string(width, '-') << "+" << RESET << "\n";
+    term << CYAN << "| " << GREEN << BOLD << "Version 1.0 | First Release: 2025 February 16" 
          << string(width - 46, ' ') << CYAN << "|" << RESET << "\n";
-    cout << CYAN << "+" << string(width, '=') << "+" << RESET << "\n\n";
+    term << CYAN << "+" << string(width, '=') << "+" << RESET << "\n\n";
     
     // User Instructions
-    cout << WHITE << "Type " << BLUE << BOLD << "HELP" 
+    term << WHITE << "Type " << BLUE << BOLD << "HELP" 
          << WHITE << " to see available commands" << RESET << "\n";
-    cout << WHITE << "Press " << BLUE << BOLD << "ENTER" 
+    term << WHITE << "Press " << BLUE << BOLD << "ENTER" 
          << WHITE << " to continue..." << RESET;
     
+    term.flush();
     cin.get();
     clearScreen();
 }
@@ -387,7 +397,8 @@ int main() {
 
     while (isRunning) {
         // Display command prompt
-        cout << CYAN << BOLD << "[logic]> " << WHITE;
+        term << CYAN << BOLD << "[logic]> " << WHITE;
+        term.flush();
         getline(cin, command);
         
         // Convert command to uppercase for case-insensitive comparison
@@ -399,8 +410,8 @@ int main() {
             displayHelp();
         } 
         else if (upperCommand == "EXIT") {
-            cout << "\n" << YELLOW << "Thank you for using Logic Gates Lab!" << RESET << "\n";
-            cout << BLUE << "Developed by: " << WHITE << "Upendra Shahi" << RESET << "\n\n";
+            term << "\n" << YELLOW << "Thank you for using Logic Gates Lab!" << RESET << "\n";
+            term << BLUE << "Developed by: " << WHITE << "Upendra Shahi" << RESET << "\n\n";
             isRunning = false;
         } 
         else if (upperCommand == "CLS") {
@@ -426,20 +437,20 @@ int main() {
                     try {
                         numInputs = stoi(numInputsStr);
                         if (numInputs < 1 || numInputs > 16) {
-                            cout << RED << "Error: Number of inputs must be between 1 and 16." 
+                            term << RED << "Error: Number of inputs must be between 1 and 16." 
                                  << RESET << "\n";
                             continue;
                         }
                     } 
                     catch (const invalid_argument& e) {
-                        cout << RED << "Error: Invalid number of inputs. Using default (2)." 
+                        term << RED << "Error: Invalid number of inputs. Using default (2)." 
                              << RESET << "\n";
                         numInputs = 2;
                     }
                 }
             } 
             else {
-                cout << RED << "Error: Invalid command. Type " << BLUE << "HELP" 
+                term << RED << "Error: Invalid command. Type " << BLUE << "HELP" 
                      << RED << " for available commands." << RESET << "\n";
                 continue;
             }
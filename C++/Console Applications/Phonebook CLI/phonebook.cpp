@@ -1,377 +1,584 @@
-#include <iostream>
-#include <fstream>
-#include <string>
-#include <vector>
-#include <algorithm>
-#include <sstream>
-#include <iomanip>
-#include <cctype>
-#include <regex>
-
-// Platform-specific definitions for screen clearing
-#ifdef _WIN32
-    #define CLEAR_COMMAND "cls"
-    #include <windows.h>
-#else
-    #define CLEAR_COMMAND "clear"
+// The book's files are kept next to this file, and with --embedded the book lives at its end
+const char* const PHONEBOOK_SOURCE = __FILE__;
+#include "../../headers/custom/phonebook/phonebook.h"
+
+#ifndef _WIN32
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <csignal>
 #endif
-
-using namespace std;
-
-// Color codes for console (cross-platform)
-#ifdef _WIN32
-    enum Color { BLACK = 0, BLUE = 1, GREEN = 2, CYAN = 3, RED = 4, MAGENTA = 5, YELLOW = 6, WHITE = 7, DARK_YELLOW = 14, LIGHT_GRAY = 8, LIGHT_CYAN = 11 };
-    void setColor(int color) { // Set console text color on Windows
-        HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-        SetConsoleTextAttribute(hConsole, color);
-    }
-#else
-    void setColor(const string& color) { cout << color; } // Set ANSI color codes on Unix-like systems
-    const string RESET = "\033[0m";
-    const string RED = "\033[31m";
-    const string GREEN = "\033[32m";
-    const string YELLOW = "\033[33m";
-    const string BLUE = "\033[34m";
-    const string MAGENTA = "\033[35m";
-    const string CYAN = "\033[36m";
-    const string WHITE = "\033[37m";
-    const string DARK_YELLOW = "\033[33m";
-    const string LIGHT_GRAY = "\033[90m";
-    const string LIGHT_CYAN = "\033[96m";
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #define PHONEBOOK_SERVER 1 // --serve needs epoll
 #endif
 
-// Class to represent a contact
-class Contact {
-private:
-    string name;   // Contact name
-    string phone;  // Contact phone number
-    string email;  // Contact email address
-
-public:
-    Contact(const string& n = "Unknown", const string& p = "0000000000", const string& e = "unknown@none.com") 
-        : name(n), phone(p), email(e) {} // Constructor with default values
-    
-    // Getter methods
-    string getName() const { return name; }
-    string getPhone() const { return phone; }
-    string getEmail() const { return email; }
-    
-    // Setter methods with default value handling
-    void setName(const string& n) { name = (n == "-" ? "Unknown" : n); }
-    void setPhone(const string& p) { phone = (p == "-" ? "0000000000" : p); }
-    void setEmail(const string& e) { email = (e == "-" ? "unknown@none.com" : e); }
-    
-    string toString() const { return name + ":" + phone + ":" + email; } // Format contact as string for file storage
-};
 
-// Validation functions
-bool isValidPhone(const string& input) {
-    static const regex phoneRegex(R"(^\d{8,15}$)"); // Regex for 8-15 digits
-    string digits = input == "-" ? "0000000000" : input;
-    return all_of(digits.begin(), digits.end(), [](char c) { return isdigit(c); }) && regex_match(digits, phoneRegex);
-}
-
-bool isValidEmail(const string& input) {
-    static const regex emailRegex(R"(^[a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,}$)");
-    return input == "-" || regex_match(input, emailRegex); // Allow "-" or valid email format
+// Display home page
+void displayHome() {
+    clearScreen();
+    setColor(LIGHT_CYAN); 
+    term << "+------------------------------------------+\n";
+    term << "|       Welcome to Phonebook CLI           |\n";
+    term << "|     Developed by: @Upendra237            |\n";
+    term << "|   First Release: February 20, 2025       |\n";
+    term << "+------------------------------------------+\n"; 
+    setColor(WHITE);
+    term << "\nFeatures:\n";
+    setColor(DARK_YELLOW);
+    term << "  * Add contacts with name, phone, email (auto-detected)\n";
+    term << "  * Delete by name, phone, or email\n";
+    term << "  * Search across all fields\n";
+    term << "  * Beautiful table display\n";
+    term << "  * Sort alphabetically\n";
+    term << "  * Use '-' for optional fields\n";
+    term << "  * Contacts saved in a binary store (phonebook.db)\n";
+    setColor(LIGHT_GRAY);
+    term << "\nType 'help' for commands\n";
+    setColor(WHITE);
 }
 
-bool isValidName(const string& input) {
-    if (input == "-" || input.empty()) return true; // Allow "-" or empty for default
-    if (input.length() < 1 || input.length() > 50) return false; // Length check
-    return all_of(input.begin(), input.end(), [](char c) { return isalpha(c) || isdigit(c) || c == ' ' || c == '-' || c == '\''; });
+// Display help menu
+void displayHelp() {
+    setColor(LIGHT_CYAN);
+    term << "\n+-------------------+------------------------------------------+\n";
+    term << "| Command           | Description                              |\n";
+    term << "+-------------------+------------------------------------------+\n";
+    setColor(WHITE);
+    term << "| 1. add            | Add a new contact (any order)            |\n";
+    term << "| 2. delete         | Delete by name, phone, or email          |\n";
+    term << "| 3. search         | Search all fields, or --prefix <name>    |\n";
+    term << "| 4. list           | Show contacts: [page] [size] or --stream |\n";
+    term << "| 5. fuzzy          | Names within [k] typos (default 2)       |\n";
+    term << "| 6. lookup-phone   | Caller ID: exact or longest prefix phone |\n";
+    term << "| 7. prefix-phone   | Contacts whose phone starts with digits  |\n";
+    term << "| 8. sort           | Sort alphabetically                      |\n";
+    term << "| 9. flush          | Write all changes to disk now            |\n";
+    term << "| 10. import        | Import contacts from a CSV or vCard file |\n";
+    term << "| 11. export        | Export to a csv, json or vcard file      |\n";
+    term << "| 12. table-stats   | Compare columnar vs row memory and scans |\n";
+    term << "| 13. store-stats   | Plain vs compressed store, [name] lookup |\n";
+    term << "| 14. read-bench    | Reads/s under a writer: lock-free vs lock|\n";
+    term << "| 15. search-bench  | Sharded search scaling over 1..N threads |\n";
+    term << "| 16. home          | Show home page                           |\n";
+    term << "| 17. cls           | Clear screen                             |\n";
+    term << "| 18. exit          | Quit program                             |\n";
+    setColor(LIGHT_CYAN);
+    term << "+-------------------+------------------------------------------+\n";
+    setColor(LIGHT_GRAY);
+    term << "Note: Use '-' for optional fields (e.g., add Ram - ram@example.com)\n";
+    setColor(WHITE);
 }
 
-// Field detection
-bool isPhone(const string& input) { return isValidPhone(input); }
-bool isEmail(const string& input) { return isValidEmail(input) && input.find('@') != string::npos; }
-bool isName(const string& input) { return isValidName(input) && !isPhone(input) && !isEmail(input); }
-
-// Load contacts from the last DATA_SECTION in the file
-vector<Contact> loadContacts() {
-    vector<Contact> contacts;
-    ifstream file(__FILE__);
-    if (!file.is_open()) return contacts; // Return empty vector if file can't be opened
-
-    vector<string> lines;
-    string line;
-    while (getline(file, line)) lines.emplace_back(move(line)); // Efficiently read lines
-    file.close();
-
-    for (int i = lines.size() - 1; i >= 0; --i) {
-        if (lines[i].find("// DATA_SECTION") != string::npos) {
-            for (int j = i + 1; j < lines.size(); ++j) {
-                if (lines[j].find("// ") == 0) {
-                    string entry = lines[j].substr(3);
-                    size_t pos1 = entry.find(':');
-                    size_t pos2 = entry.find(':', pos1 + 1);
-                    if (pos1 != string::npos && pos2 != string::npos) {
-                        contacts.emplace_back(entry.substr(0, pos1),
-                                              entry.substr(pos1 + 1, pos2 - pos1 - 1),
-                                              entry.substr(pos2 + 1));
-                    }
-                }
-            }
-            break;
+// Parse input allowing flexible order and spaces in name. The parameters are views into input
+// and params keeps its capacity between commands, so tokenizing does not allocate.
+void parseInput(string_view input, string& command, vector<string_view>& params) {
+    auto space = [](char c) { return isspace(static_cast<unsigned char>(c)) != 0; };
+    size_t pos = 0;
+    while (pos < input.size() && space(input[pos])) ++pos;
+    size_t end = pos;
+    while (end < input.size() && !space(input[end])) ++end;
+    command.assign(input.substr(pos, end - pos));
+    params.clear();
+    for (pos = end; ; ) {
+        while (pos < input.size() && space(input[pos])) ++pos;
+        if (pos >= input.size()) break;
+        end = min(input.find(' ', pos), input.size());
+        string_view param = input.substr(pos, end - pos);
+        if (param.front() == '"' && param.back() != '"') { // A quoted name runs to the closing quote
+            end = min(input.find('"', end), input.size());
+            param = input.substr(pos + 1, end - pos - 1);
+        } else if (param.front() == '"') {
+            param = param.substr(1, param.size() >= 2 ? param.size() - 2 : 0);
         }
+        params.push_back(param);
+        pos = end + 1;
     }
-    return contacts;
 }
 
-// Save contacts back to the file
-void saveContacts(vector<Contact>& contacts) {
-    ifstream inFile(__FILE__);
-    stringstream buffer;
-    vector<string> lines;
-    string line;
-
-    while (getline(inFile, line)) lines.emplace_back(move(line));
-    inFile.close();
-
-    int lastDataSection = -1;
-    for (int i = lines.size() - 1; i >= 0; --i) {
-        if (lines[i].find("// DATA_SECTION") != string::npos) {
-            lastDataSection = i;
-            break;
-        }
-    }
-
-    if (lastDataSection == -1) {
-        for (const auto& l : lines) buffer << l << '\n';
-        buffer << "// DATA_SECTION\n";
-    } else {
-        for (int i = 0; i <= lastDataSection; ++i) buffer << lines[i] << '\n';
-    }
-
-    buffer << "// Add your contacts below this line as comments in format: // name:phone:email\n";
-    for (const auto& contact : contacts) buffer << "// " << contact.toString() << '\n';
-
-    ofstream outFile(__FILE__);
-    outFile << buffer.str(); // Overwrite file with updated content
+// Run a command that only reads the book; false if it is not one or lacks its parameters
+bool runQuery(const ContactBook& contacts, const string& command, const vector<string_view>& params) {
+    if (command == "search" && params.size() > 1 && params[0] == "--prefix") searchContacts(contacts, params[1], true);
+    else if (command == "search" && !params.empty()) searchContacts(contacts, params[0]);
+    else if (command == "fuzzy" && !params.empty()) fuzzySearch(contacts, params[0], params.size() > 1 ? min(10, max(0, parseInt(params[1]))) : 2);
+    else if (command == "lookup-phone" && !params.empty()) lookupPhone(contacts, params[0]);
+    else if (command == "prefix-phone" && !params.empty()) phonePrefixSearch(contacts, params[0]);
+    else if (command == "list") displayContacts(contacts, params);
+    else return false;
+    return true;
 }
 
-// Display contacts in a formatted table
-void displayContacts(const vector<Contact>& contacts) {
-    if (contacts.empty()) {
-        setColor(LIGHT_GRAY); cout << "\n  *** Phonebook is empty! ***\n"; setColor(WHITE);
-        return;
+// Run one command; returns false once the user asks to exit
+bool runCommand(ContactBook& contacts, const string& command, const vector<string_view>& params) {
+    if (command == "add" && !params.empty()) addContact(contacts, params);
+    else if (command == "delete" && !params.empty()) deleteContact(contacts, params[0]);
+    else if (batchMode && (command == "cls" || command == "home" || command == "help")) {} // Nothing to show
+    else if (command == "cls") clearScreen();
+    else if (runQuery(contacts, command, params)) {}
+    else if (command == "sort") sortContacts(contacts);
+    else if (command == "flush") flushContacts();
+    else if (command == "import" && !params.empty()) importContacts(contacts, string(params[0]));
+    else if (command == "export" && !params.empty()) exportContacts(contacts, string(params[0]), params.size() > 1 ? string(params[1]) : "");
+    else if (batchMode && (command == "table-stats" || command == "store-stats" || command == "read-bench" || command == "search-bench")) {
+        report(Outcome::Error, "Command not available in batch mode!");
     }
-    setColor(BLUE); // Darker blue for borders
-    cout << "\n=======================================================================================================+\n";
-    setColor(CYAN); // Darker cyan for title
-    cout << "|                                    *** PHONEBOOK CONTACTS ***                                        |\n";
-    setColor(BLUE);
-    cout << "+===================================+=======================+==========================================+\n";
-    cout << "|               NAME                |         PHONE         |                   EMAIL                  |\n";
-    cout << "+===================================+=======================+==========================================+\n";
-    for (const auto& contact : contacts) {
-        setColor(WHITE); 
-        cout << "| ";
-        setColor(LIGHT_CYAN); // Soft cyan for names
-        cout << left << setw(33) << contact.getName().substr(0, 33) << " ";
-        setColor(WHITE);
-        cout << "| ";
-        setColor(LIGHT_GRAY); // Soft gray for phone numbers
-        cout << setw(21) << contact.getPhone().substr(0, 21) << " ";
-        setColor(WHITE);
-        cout << "| ";
-        setColor(DARK_YELLOW); // Soft dark yellow for emails
-        cout << setw(40) << contact.getEmail().substr(0, 40) << " ";
-        setColor(WHITE);
-        cout << "|\n";
-        setColor(BLUE);
-        cout << "+-----------------------------------+-----------------------+------------------------------------------+\n";
+    else if (command == "table-stats") compareTableLayout(contacts);
+    else if (command == "store-stats") storeStats(contacts, params.empty() ? "" : string(params[0]));
+    else if (command == "search-bench") {
+        size_t threads = params.size() > 1 ? max(1, parseInt(params[1])) : searchPool().size();
+        benchmarkParallelSearch(contacts, params.empty() ? "" : string(params[0]), threads);
     }
-    setColor(CYAN);
-    cout << "# TOTAL CONTACTS: ";
-    setColor(YELLOW); // Slightly brighter yellow for total count
-    cout << setw(17) << contacts.size() << "\n";
-    setColor(WHITE);
-}
-
-// Search contacts by name, phone, or email
-void searchContacts(const vector<Contact>& contacts, const string& query) {
-    bool found = false;
-    for (const auto& contact : contacts) {
-        if (contact.getName().find(query) != string::npos || 
-            contact.getPhone().find(query) != string::npos ||
-            contact.getEmail().find(query) != string::npos) {
-            setColor(GREEN); 
-            cout << contact.getName() << " - " << contact.getPhone() << " - " << contact.getEmail() << '\n';
-            setColor(WHITE);
-            found = true;
-        }
+    else if (command == "read-bench") {
+        size_t readers = params.empty() ? max(1u, thread::hardware_concurrency()) : max(1, parseInt(params[0]));
+        benchmarkConcurrentReads(contacts, readers, params.size() > 1 ? max(10, parseInt(params[1])) : 500);
     }
-    if (!found) {
-        setColor(YELLOW); cout << "No matching contacts found!\n"; setColor(WHITE);
+    else if (command == "home") displayHome();
+    else if (command == "help") displayHelp();
+    else if (command == "exit") {
+        if (!batchMode) { setColor(GREEN); term << "Goodbye!\n"; setColor(WHITE); }
+        return false;
     }
+    else report(Outcome::Error, "Invalid command! Type 'help' for available commands.");
+    return true;
 }
 
-// Delete a contact by name, phone, or email
-void deleteContact(vector<Contact>& contacts, const string& query) {
-    vector<Contact> newContacts;
-    bool found = false;
-    for (const auto& contact : contacts) {
-        if (contact.getName() != query && contact.getPhone() != query && contact.getEmail() != query) {
-            newContacts.push_back(contact);
-        } else found = true;
-    }
-    if (found) {
-        contacts = move(newContacts);
-        saveContacts(contacts);
-        setColor(GREEN); cout << "Contact deleted permanently!\n"; setColor(WHITE);
-    } else {
-        setColor(YELLOW); cout << "Contact not found!\n"; setColor(WHITE);
+// Append the JSON result line for the op-th command, built from what it reported
+void formatBatchResult(string& line, size_t op, const string& command) {
+    static const char* STATUS[] = { "ok", "warning", "error" };
+    char digits[24];
+    line += "{\"op\":";
+    line.append(digits, to_chars(digits, digits + sizeof(digits), op).ptr - digits);
+    line += ",\"command\":";
+    appendJsonString(line, command);
+    line += ",\"status\":\"";
+    line += STATUS[static_cast<int>(batchResult.outcome)];
+    line += "\",\"message\":";
+    appendJsonString(line, batchResult.message);
+    if (command == "search" || command == "fuzzy" || command == "lookup-phone" || command == "prefix-phone" || command == "list") {
+        line += ",\"results\":[";
+        line += batchResult.results;
+        line += ']';
     }
+    line += "}\n";
 }
 
-// Check for duplicate names, allowing multiple "Unknown" or "-"
-bool hasDuplicateName(const vector<Contact>& contacts, const string& name) {
-    return name != "Unknown" && name != "-" && any_of(contacts.begin(), contacts.end(), 
-        [&name](const Contact& c) { return c.getName() == name; });
-}
-
-// Add a contact with flexible parameters
-void addContact(vector<Contact>& contacts, const vector<string>& params) {
-    if (params.empty()) {
-        setColor(RED); cout << "Please provide at least one parameter!\n"; setColor(WHITE);
-        return;
+// Run the commands of a script (stdin for "" or "-"), printing one JSON result line per command:
+//   {"op":1,"command":"add","status":"ok","message":"Contact added!"}
+// search and list also carry "results". Logged mutations are flushed every commitEvery commands
+// (0: once at the end), and a closing summary line gives the throughput.
+int runBatch(ContactBook& contacts, const string& path, size_t commitEvery) {
+    ifstream file;
+    if (!path.empty() && path != "-") {
+        file.open(path);
+        if (!file.is_open()) {
+            string error = "{\"error\":";
+            appendJsonString(error, "Cannot open " + path);
+            term << error << "}\n";
+            return 1;
+        }
     }
+    istream& in = file.is_open() ? file : cin;
+
+    size_t ops = 0, errors = 0, commits = 0, sinceCommit = 0;
+    bool committed = true;
+    string input, command, line;
+    vector<string_view> params;
+    auto commit = [&] {
+        if (!wal.commit()) ++errors;
+        ++commits;
+        sinceCommit = 0;
+    };
+    auto start = chrono::steady_clock::now();
+    while (getline(in, input)) {
+        size_t first = input.find_first_not_of(" \t\r");
+        if (first == string::npos || input[first] == '#') continue; // Blank lines and comments
+        if (input.back() == '\r') input.pop_back();
+        parseInput(input, command, params);
+        transform(command.begin(), command.end(), command.begin(), ::tolower);
 
-    string name = "-", phone = "-", email = "-";
-    bool nameSet = false;
+        batchResult.clear();
+        bool keepGoing = runCommand(contacts, command, params);
+        ++ops;
+        if (batchResult.outcome == Outcome::Error) ++errors;
 
-    for (const auto& param : params) {
-        if (isPhone(param) && phone == "-") phone = param;
-        else if (isEmail(param) && email == "-") email = param;
-        else if (isName(param) && !nameSet) {
-            name = param;
-            nameSet = true;
+        line.clear();
+        formatBatchResult(line, ops, command);
+        term << line;
+
+        committed = false;
+        if (commitEvery > 0 && ++sinceCommit >= commitEvery) {
+            commit();
+            committed = true;
         }
+        if (!keepGoing) break;
     }
+    if (!committed) commit();
+    if (!wal.flush()) ++errors; // The script's changes are on disk before the summary
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    term << "{\"summary\":{\"ops\":" << ops << ",\"errors\":" << errors << ",\"commits\":" << commits
+         << ",\"seconds\":" << terminal::fixed(seconds, 6)
+         << ",\"ops_per_second\":" << terminal::fixed(ops / max(seconds, 1e-9), 1) << "}}\n";
+    term.flush();
+    return errors == 0 ? 0 : 1;
+}
 
-    if (!isValidName(name)) {
-        setColor(RED); cout << "Invalid name! Must be 1-50 characters (letters, digits, spaces, -, ' only).\n"; setColor(WHITE);
-        return;
+#ifdef PHONEBOOK_SERVER
+// Server mode (--serve): the book and its indexes stay resident and clients talk to it over a
+// Unix domain socket. Both directions use frames of a u32 little-endian length followed by that
+// many bytes; a request is one command line (add, delete, search, fuzzy or list) and the reply is the
+// JSON result line batch mode would print for it.
+const string SOCKET_FILE = storePath("phonebook.sock");
+const size_t MAX_FRAME_BYTES = 1 << 20;   // Longer requests close the connection
+const int SERVER_EVENTS = 64;             // Events taken per epoll_wait
+
+volatile sig_atomic_t stopServer = 0;
+void requestStop(int) { stopServer = 1; }
+
+// Socket address for path; false if it does not fit in sun_path
+bool socketAddress(const string& path, sockaddr_un& address) {
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return false;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// One connected client: received bytes not yet framed, and reply bytes not yet sent
+struct ServerClient {
+    string in;
+    string out;
+    size_t sent = 0;
+    bool open = true;
+};
+
+// Run one request line and frame its result. Reads use the published copy of the book; add and
+// delete run on the other copy, logged and reported once, and are then replayed on the first.
+void serveRequest(ConcurrentBook& book, string_view request, size_t op, string& reply) {
+    thread_local string command, line; // Reused by each serving thread
+    thread_local vector<string_view> params;
+    parseInput(request, command, params);
+    transform(command.begin(), command.end(), command.begin(), ::tolower);
+    batchResult.clear();
+    if (command != "add" && command != "delete" && command != "search" && command != "fuzzy" &&
+        command != "lookup-phone" && command != "prefix-phone" && command != "list" && command != "flush") {
+        report(Outcome::Error, "Command not available in server mode!");
     }
-    if (hasDuplicateName(contacts, name)) {
-        setColor(YELLOW); cout << "Record with name '" << name << "' already exists!\n"; setColor(WHITE);
-        return;
+    else if (command == "add" && !params.empty()) {
+        book.write([&](ContactBook& contacts) { return addContact(contacts, params); },
+                   [](ContactBook& contacts, const Contact* added) {
+                       if (added) contacts.add(Contact(added->getName(), added->getPhone(), added->getEmail()));
+                   });
     }
-    if (!isValidPhone(phone)) {
-        setColor(RED); cout << "Invalid phone number! Must be 8-15 digits.\n"; setColor(WHITE);
-        return;
+    else if (command == "delete" && !params.empty()) {
+        book.write([&](ContactBook& contacts) { return deleteContact(contacts, params[0]); },
+                   [&](ContactBook& contacts, bool deleted) { if (deleted) contacts.removeMatching(params[0]); });
     }
-    if (!isValidEmail(email)) {
-        setColor(RED); cout << "Invalid email format!\n"; setColor(WHITE);
-        return;
+    else if (command == "flush") flushContacts();
+    else if (!book.read([&](const ContactBook& contacts) { return runQuery(contacts, command, params); })) {
+        report(Outcome::Error, "Invalid command! Type 'help' for available commands.");
     }
-
-    contacts.emplace_back(name, phone, email);
-    saveContacts(contacts);
-    setColor(GREEN); cout << "Contact added!\n"; setColor(WHITE);
+    line.clear();
+    formatBatchResult(line, op, command);
+    putU32(reply, line.size());
+    reply += line;
 }
 
-// Sort contacts alphabetically by name
-void sortContacts(vector<Contact>& contacts) {
-    sort(contacts.begin(), contacts.end(), 
-         [](const Contact& a, const Contact& b) { return a.getName() < b.getName(); });
-    saveContacts(contacts);
-    setColor(GREEN); cout << "Contacts sorted alphabetically!\n"; setColor(WHITE);
+// Send as much pending reply data as the socket takes; false once the client is gone
+bool sendReplies(int fd, ServerClient& client) {
+    while (client.sent < client.out.size()) {
+        ssize_t written = send(fd, client.out.data() + client.sent, client.out.size() - client.sent, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (written <= 0) return false;
+        client.sent += written;
+    }
+    client.out.clear();
+    client.sent = 0;
+    return true;
 }
 
-// Display home page
-void displayHome() {
-    system(CLEAR_COMMAND);
-    setColor(LIGHT_CYAN); 
-    cout << "+------------------------------------------+\n";
-    cout << "|       Welcome to Phonebook CLI           |\n";
-    cout << "|     Developed by: @Upendra237            |\n";
-    cout << "|   First Release: February 20, 2025       |\n";
-    cout << "+------------------------------------------+\n"; 
-    setColor(WHITE);
-    cout << "\nFeatures:\n";
-    setColor(DARK_YELLOW);
-    cout << "  * Add contacts with name, phone, email (auto-detected)\n";
-    cout << "  * Delete by name, phone, or email\n";
-    cout << "  * Search across all fields\n";
-    cout << "  * Beautiful table display\n";
-    cout << "  * Sort alphabetically\n";
-    cout << "  * Use '-' for optional fields\n";
-    cout << "  * All contacts saved within the .cpp file\n";
-    setColor(LIGHT_GRAY);
-    cout << "\nType 'help' for commands\n";
-    setColor(WHITE);
+// Serve until SIGINT or SIGTERM. One thread runs an edge-triggered epoll loop: each round reads
+// every complete request that arrived and runs them on a thread pool, each client's requests in
+// order on one thread, so searches from different clients run in parallel and never wait for
+// writes. It then has the round's changes written to the log as one write (synced too under
+// --fsync=always) and waits for it, and only then sends the replies. An acknowledged change
+// therefore survives the server crashing; with the other fsync policies it can still be lost to
+// a power failure until the next sync or a flush request.
+int runServer(ContactBook& contacts, const string& path) {
+    sockaddr_un address;
+    if (!socketAddress(path, address)) {
+        setColor(RED); term << "Socket path too long: " << path << "\n"; setColor(WHITE);
+        return 1;
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(path.c_str()); // A socket file left by a server that did not shut down cleanly
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0) {
+        setColor(RED); term << "Cannot listen on " << path << ": " << strerror(errno) << "\n"; setColor(WHITE);
+        return 1;
+    }
+    int poller = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listener;
+    epoll_ctl(poller, EPOLL_CTL_ADD, listener, &event);
+
+    struct sigaction stop{};
+    stop.sa_handler = requestStop; // No SA_RESTART: epoll_wait returns EINTR and the loop checks the flag
+    sigaction(SIGINT, &stop, nullptr);
+    sigaction(SIGTERM, &stop, nullptr);
+
+    ConcurrentBook book(contacts); // contacts stays current and is the copy saved on exit
+    WorkStealingPool pool(searchThreads > 0 ? searchThreads : thread::hardware_concurrency());
+    setColor(GREEN); term << "Serving " << contacts.size() << " contacts on " << path << " with " << pool.size() << " threads (Ctrl+C to stop)\n"; setColor(WHITE);
+    term.flush();
+
+    unordered_map<int, ServerClient> clients;
+    vector<int> replying;
+    vector<ServerClient*> serving;
+    atomic<size_t> served{0};
+    epoll_event events[SERVER_EVENTS];
+    char buffer[64 * 1024];
+    // Run every complete request a client has sent, in order
+    auto serveClient = [&](size_t i) {
+        ServerClient& client = *serving[i];
+        size_t pos = 0;
+        while (client.in.size() - pos >= 4) {
+            size_t length = getU32(client.in.data() + pos);
+            if (length > MAX_FRAME_BYTES) { client.open = false; break; }
+            if (client.in.size() - pos - 4 < length) break;
+            serveRequest(book, string_view(client.in).substr(pos + 4, length), ++served, client.out);
+            pos += 4 + length;
+        }
+        client.in.erase(0, pos);
+    };
+    while (!stopServer) {
+        int ready = epoll_wait(poller, events, SERVER_EVENTS, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        replying.clear();
+        serving.clear();
+        uint64_t roundStart = wal.lastLsn();
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listener) {
+                int accepted;
+                while ((accepted = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    epoll_event clientEvent{};
+                    clientEvent.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                    clientEvent.data.fd = accepted;
+                    epoll_ctl(poller, EPOLL_CTL_ADD, accepted, &clientEvent);
+                    clients[accepted];
+                }
+                continue;
+            }
+            auto it = clients.find(fd);
+            if (it == clients.end()) continue;
+            ServerClient& client = it->second;
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                while (true) { // Edge-triggered: drain the socket
+                    ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+                    if (received > 0) { client.in.append(buffer, received); continue; }
+                    if (received < 0 && errno == EINTR) continue;
+                    if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) client.open = false;
+                    break;
+                }
+                if (client.in.size() >= 4) serving.push_back(&client);
+            }
+            replying.push_back(fd);
+        }
+        if (serving.size() > 1) pool.parallelFor(serving.size(), serveClient);
+        else if (!serving.empty()) serveClient(0);
+        if (wal.lastLsn() != roundStart && !wal.commit(true)) {
+            // The round's changes may not be in the log: leave them unacknowledged
+            for (int fd : replying) {
+                close(fd);
+                clients.erase(fd);
+            }
+            replying.clear();
+        }
+        for (int fd : replying) {
+            ServerClient& client = clients[fd];
+            if (!sendReplies(fd, client) || (!client.open && client.out.empty())) {
+                close(fd);
+                clients.erase(fd);
+            }
+        }
+    }
+
+    for (const auto& client : clients) close(client.first);
+    close(poller);
+    close(listener);
+    unlink(path.c_str());
+    wal.flush();
+    setColor(GREEN); term << "\nServed " << served.load() << " requests\n"; setColor(WHITE);
+    return 0;
 }
 
-// Display help menu
-void displayHelp() {
-    setColor(LIGHT_CYAN);
-    cout << "\n+------------------+------------------------------------------+\n";
-    cout << "| Command          | Description                              |\n";
-    cout << "+------------------+------------------------------------------+\n";
-    setColor(WHITE);
-    cout << "| 1. add           | Add a new contact (any order)            |\n";
-    cout << "| 2. delete        | Delete by name, phone, or email          |\n";
-    cout << "| 3. search        | Search across all fields                 |\n";
-    cout << "| 4. list          | Show all contacts                        |\n";
-    cout << "| 5. sort          | Sort alphabetically                      |\n";
-    cout << "| 6. home          | Show home page                           |\n";
-    cout << "| 7. cls           | Clear screen                             |\n";
-    cout << "| 8. exit          | Quit program                             |\n";
-    setColor(LIGHT_CYAN);
-    cout << "+------------------+------------------------------------------+\n";
-    setColor(LIGHT_GRAY);
-    cout << "Note: Use '-' for optional fields (e.g., add Ram - ram@example.com)\n";
-    setColor(WHITE);
+// Blocking helpers for the load generator
+bool sendAll(int fd, const string& data) {
+    for (size_t done = 0; done < data.size();) {
+        ssize_t written = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        done += written;
+    }
+    return true;
+}
+bool receiveAll(int fd, char* data, size_t size) {
+    for (size_t done = 0; done < size;) {
+        ssize_t received = recv(fd, data + done, size - done, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        done += received;
+    }
+    return true;
 }
 
-// Parse input allowing flexible order and spaces in name
-vector<string> parseInput(const string& input, string& command) {
-    vector<string> params;
-    stringstream ss(input);
-    ss >> command;
-    string param;
-    while (getline(ss >> ws, param, ' ')) {
-        if (!param.empty()) {
-            if (param.front() == '"' && param.back() != '"') {
-                string rest;
-                getline(ss, rest, '"');
-                param = param.substr(1) + " " + rest;
-            } else if (param.front() == '"' && param.back() == '"') {
-                param = param.substr(1, param.length() - 2);
+// Load generator (--loadgen): clientCount threads each open a connection to a running server and
+// send `requests` requests one at a time (50% search, 30% add, 10% delete, 10% list page), timing
+// every round trip. Prints one JSON line with throughput and latency percentiles.
+int runLoadGenerator(const string& path, size_t clientCount, size_t requests) {
+    sockaddr_un address;
+    if (!socketAddress(path, address)) {
+        term << "{\"error\":\"socket path too long\"}\n";
+        return 1;
+    }
+    vector<vector<double>> latencies(clientCount);
+    atomic<size_t> failures{0};
+    auto client = [&](size_t id) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+            if (fd >= 0) close(fd);
+            failures += requests;
+            return;
+        }
+        mt19937 rng(static_cast<uint32_t>(id) * 7919 + 1);
+        vector<double>& timings = latencies[id];
+        timings.reserve(requests);
+        string frame, reply;
+        size_t added = 0;
+        for (size_t i = 0; i < requests; ++i) {
+            string name = "lg" + to_string(id) + "x";
+            uint32_t roll = rng() % 10;
+            string request;
+            if (roll < 5) request = "search " + name + to_string(added > 0 ? rng() % added : 0);
+            else if (roll < 8) {
+                request = "add " + name + to_string(added) + " " + to_string(1000000000ULL + id * 10000000ULL + added) + " " + name + to_string(added) + "@load.gen";
+                ++added;
             }
-            params.push_back(param);
+            else if (roll < 9) request = "delete " + name + to_string(added > 0 ? rng() % added : 0);
+            else request = "list " + to_string(1 + rng() % 4) + " 25";
+
+            frame.clear();
+            putU32(frame, request.size());
+            frame += request;
+            auto start = chrono::steady_clock::now();
+            char header[4];
+            if (!sendAll(fd, frame) || !receiveAll(fd, header, 4)) { failures += requests - i; break; }
+            reply.resize(getU32(header));
+            if (!receiveAll(fd, &reply[0], reply.size())) { failures += requests - i; break; }
+            timings.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
         }
-    }
-    return params;
+        close(fd);
+    };
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (size_t id = 0; id < clientCount; ++id) threads.emplace_back(client, id);
+    for (auto& t : threads) t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<double> all;
+    for (const auto& timings : latencies) all.insert(all.end(), timings.begin(), timings.end());
+    sort(all.begin(), all.end());
+    auto percentile = [&all](double p) { return all.empty() ? 0.0 : all[min(all.size() - 1, static_cast<size_t>(p * all.size()))]; };
+    term << "{\"loadgen\":{\"clients\":" << clientCount << ",\"requests\":" << all.size() << ",\"failures\":" << failures.load()
+         << ",\"seconds\":" << terminal::fixed(seconds, 3) << ",\"requests_per_second\":" << terminal::fixed(all.size() / max(seconds, 1e-9), 1)
+         << ",\"p50_us\":" << terminal::fixed(percentile(0.50), 1) << ",\"p99_us\":" << terminal::fixed(percentile(0.99), 1)
+         << ",\"max_us\":" << terminal::fixed(all.empty() ? 0.0 : all.back(), 1) << "}}\n";
+    return failures == 0 ? 0 : 1;
 }
+#endif
 
 // Main function to run the phonebook CLI
-int main() {
-    vector<Contact> contacts = loadContacts();
-    string input, command;
+int main(int argc, char* argv[]) {
+    bool mapStore = false; // --mmap: view contacts straight out of the memory-mapped store
+    string batchPath;      // --batch [file]: run a script instead of the interactive prompt
+    size_t commitEvery = 0;
+    string serveMode;      // "serve" or "loadgen", with the socket path and load settings below
+    string socketPath;
+    size_t loadClients = 8, loadRequests = 10000;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--mmap") mapStore = true;
+        else if (arg == "--store-format=plain" || arg == "--store-format=blocks") {
+            storeFormat = arg == "--store-format=plain" ? StoreFormat::Plain : StoreFormat::Blocks;
+            storeFormatChosen = true;
+        }
+        else if (arg == "--fsync=always" || arg == "--fsync=periodic" || arg == "--fsync=never") {
+            fsyncPolicy = arg == "--fsync=always" ? FsyncPolicy::Always : arg == "--fsync=never" ? FsyncPolicy::Never : FsyncPolicy::Periodic;
+        }
+        else if (arg == "--embedded") embeddedMode = true;
+        else if (arg == "--no-cache") cacheEnabled = false;
+        else if (arg == "--simd=scalar" || arg == "--simd=sse2" || arg == "--simd=avx2") scan = selectKernels(arg.substr(7)); // Force a lower kernel level
+        else if (arg.rfind("--simd=", 0) == 0) {
+            setColor(RED); term << "Unknown --simd level '" << arg.substr(7) << "' (use scalar, sse2 or avx2)\n"; setColor(WHITE);
+            return 1;
+        }
+        else if (arg == "--batch") {
+            batchMode = true;
+            if (i + 1 < argc && (argv[i + 1][0] != '-' || string(argv[i + 1]) == "-")) batchPath = argv[++i];
+        }
+        else if (arg.rfind("--commit-every=", 0) == 0) commitEvery = strtoul(arg.c_str() + 15, nullptr, 10);
+        else if (arg == "--serve" || arg == "--loadgen") {
+            serveMode = arg.substr(2);
+            if (i + 1 < argc && argv[i + 1][0] != '-') socketPath = argv[++i];
+        }
+        else if (arg.rfind("--threads=", 0) == 0) searchThreads = strtoul(arg.c_str() + 10, nullptr, 10);
+        else if (arg.rfind("--clients=", 0) == 0) loadClients = max(1UL, strtoul(arg.c_str() + 10, nullptr, 10));
+        else if (arg.rfind("--requests=", 0) == 0) loadRequests = max(1UL, strtoul(arg.c_str() + 11, nullptr, 10));
+    }
+    if (!serveMode.empty()) {
+#ifdef PHONEBOOK_SERVER
+        if (socketPath.empty()) socketPath = SOCKET_FILE;
+        if (serveMode == "loadgen") return runLoadGenerator(socketPath, loadClients, loadRequests);
+        batchMode = true; // Commands report results instead of printing
+        ContactBook contacts = loadContacts(mapStore);
+        int status = runServer(contacts, socketPath);
+        if (wal.close()) saveStartupCache(contacts);
+        return status;
+#else
+        setColor(RED); term << "--serve and --loadgen need Linux (epoll)\n"; setColor(WHITE);
+        return 1;
+#endif
+    }
+    if (batchMode) term.setColorEnabled(false);
+    ContactBook contacts = loadContacts(mapStore);
+    if (batchMode) {
+        int status = runBatch(contacts, batchPath, commitEvery);
+        if (wal.close()) saveStartupCache(contacts);
+        return status;
+    }
 
+    string input, command;
+    vector<string_view> params;
     displayHome();
 
     while (true) {
-        setColor(MAGENTA); cout << "Phonebook> "; setColor(WHITE);
-        getline(cin, input);
+        setColor(MAGENTA); term << "Phonebook> "; setColor(WHITE);
+        term.flush(); // Show everything before waiting for input
+        if (!getline(cin, input)) break; // End of input behaves like exit
         
-        vector<string> params = parseInput(input, command);
+        parseInput(input, command, params);
         transform(command.begin(), command.end(), command.begin(), ::tolower);
-
-        if (command == "add" && !params.empty()) addContact(contacts, params);
-        else if (command == "delete" && !params.empty()) deleteContact(contacts, params[0]);
-        else if (command == "cls") system(CLEAR_COMMAND);
-        else if (command == "search" && !params.empty()) searchContacts(contacts, params[0]);
-        else if (command == "list") displayContacts(contacts);
-        else if (command == "sort") sortContacts(contacts);
-        else if (command == "home") displayHome();
-        else if (command == "help") displayHelp();
-        else if (command == "exit") { setColor(GREEN); cout << "Goodbye!\n"; setColor(WHITE); break; }
-        else { setColor(RED); cout << "Invalid command! Type 'help' for available commands.\n"; setColor(WHITE); }
+        if (!runCommand(contacts, command, params)) break;
+    }
+    if (!wal.close()) { // Everything is written and synced before the program ends
+        setColor(RED); term << "Failed to write " << STORE_FILE << ".wal!\n"; setColor(WHITE);
+        return 1;
     }
+    saveStartupCache(contacts);
     return 0;
 }
 
@@ -0,0 +1,424 @@
+// Benchmark suite for the Phonebook CLI (see README.md, Benchmarks). It is a separate program so that
+// phonebook itself keeps the standard allocator: here every heap allocation is counted.
+//   g++ -std=c++17 -O2 phonebook_bench.cpp -o phonebook-bench
+const char* const PHONEBOOK_SOURCE = __FILE__;
+#include "../../headers/custom/phonebook/phonebook.h"
+
+#include <regex> // --check-validators compares the validators with the original patterns
+#ifndef _WIN32
+    #include <sys/resource.h>
+#endif
+
+// Every heap allocation is counted, so --bench can report allocations per operation
+atomic<uint64_t> heapAllocations{0};
+
+void* operator new(size_t size) {
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    if (void* block = malloc(size ? size : 1)) return block;
+    throw bad_alloc();
+}
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" // GCC pairs the inlined malloc and free across new/delete
+void operator delete(void* block) noexcept { free(block); }
+void operator delete(void* block, size_t) noexcept { free(block); }
+#pragma GCC diagnostic pop
+
+// One measured operation of the benchmark suite (--bench)
+struct BenchResult {
+    size_t size;       // Contacts in the book
+    string op;
+    size_t ops;        // Operations timed: contacts for load, save, index and sort, rows for list, else commands
+    double nsPerOp;
+    double allocsPerOp;
+    size_t peakRssKib; // Process peak so far
+};
+
+// Peak resident memory of the process in KiB, 0 where it is not available
+size_t peakRssKib() {
+#ifndef _WIN32
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // Bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+// Synthetic book with realistic fields: common first and last names far more often than rare
+// ones, some middle initials, local and international phone prefixes, and emails derived from
+// the name on a few big and many small domains
+vector<Contact> generateBook(size_t count, uint32_t seed) {
+    static const char* FIRST[] = { "James", "Mary", "John", "Patricia", "Robert", "Jennifer", "Michael", "Linda", "William",
+        "Elizabeth", "David", "Barbara", "Richard", "Susan", "Joseph", "Jessica", "Thomas", "Sarah", "Charles", "Karen",
+        "Ram", "Sita", "Hari", "Gita", "Bikash", "Sunita", "Rajesh", "Anita", "Suresh", "Prakash", "Daniel", "Nancy",
+        "Matthew", "Lisa", "Anthony", "Betty", "Mark", "Sandra", "Steven", "Ashley", "Kevin", "Emily", "Brian", "Donna" };
+    static const char* LAST[] = { "Smith", "Johnson", "Williams", "Brown", "Jones", "Garcia", "Miller", "Davis", "Rodriguez",
+        "Martinez", "Wilson", "Anderson", "Taylor", "Thomas", "Moore", "Jackson", "Martin", "Lee", "Thompson", "White",
+        "Shrestha", "Sharma", "Thapa", "Gurung", "Tamang", "Rai", "Magar", "Adhikari", "Karki", "Poudel", "Manandhar",
+        "Maharjan", "Joshi", "Pandey", "Bhattarai", "Harris", "Clark", "Lewis", "Walker", "Young", "Allen", "King", "Wright" };
+    static const char* PREFIXES[] = { "980", "981", "984", "985", "986", "1415", "1212", "4420" };
+    static const char* DOMAINS[] = { "gmail.com", "yahoo.com", "hotmail.com", "outlook.com", "icloud.com", "proton.me" };
+    mt19937 rng(seed);
+    auto skewed = [&rng](size_t n) { double u = (rng() % 10000) / 10000.0; return static_cast<size_t>(n * u * u); };
+
+    vector<Contact> rows;
+    rows.reserve(count);
+    string name, phone, email;
+    for (size_t i = 0; i < count; ++i) {
+        string_view first = FIRST[skewed(size(FIRST))], last = LAST[skewed(size(LAST))];
+        name.assign(first);
+        name += ' ';
+        if (rng() % 4 == 0) {
+            name += static_cast<char>('A' + rng() % 26);
+            name += ' ';
+        }
+        name += last;
+        phone = PREFIXES[rng() % size(PREFIXES)];
+        for (int digit = 0; digit < 7; ++digit) phone += static_cast<char>('0' + rng() % 10);
+        email.clear();
+        for (char c : first) email += static_cast<char>(tolower(c));
+        email += '.';
+        for (char c : last) email += static_cast<char>(tolower(c));
+        if (rng() % 2) email += to_string(rng() % 1000);
+        email += '@';
+        email += rng() % 5 ? string(DOMAINS[skewed(size(DOMAINS))]) : "corp" + to_string(rng() % 500) + ".com";
+        rows.emplace_back(name, phone, email);
+    }
+    return rows;
+}
+
+// Time run(), which performs ops operations, and record ns and heap allocations per operation
+template <typename Run>
+void measureBench(vector<BenchResult>& results, size_t size, const string& op, size_t ops, Run run) {
+    uint64_t allocations = heapAllocations.load();
+    auto start = chrono::steady_clock::now();
+    run();
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    ops = max<size_t>(1, ops);
+    results.push_back(BenchResult{ size, op, ops, ns / ops, static_cast<double>(heapAllocations.load() - allocations) / ops, peakRssKib() });
+}
+
+// Run command paths with stdout sent to /dev/null: tables and messages are formatted, colored and
+// written as on a terminal, but stay out of the JSON results
+template <typename Run>
+void silenced(Run run) {
+    term.flush();
+#ifndef _WIN32
+    int saved = dup(STDOUT_FILENO), sink = open("/dev/null", O_WRONLY);
+    if (sink >= 0) dup2(sink, STDOUT_FILENO);
+#endif
+    term.setColorEnabled(true);
+    run();
+    term.flush();
+    term.setColorEnabled(false);
+#ifndef _WIN32
+    if (saved >= 0) {
+        dup2(saved, STDOUT_FILENO);
+        ::close(saved);
+    }
+    if (sink >= 0) ::close(sink);
+#endif
+}
+
+// Benchmark the book's operations on a synthetic book of size contacts. search, list, add, delete
+// and sort run the interactive commands, logging included; the snapshot and log are scratch files
+// next to the store, and the user's own book is never touched.
+vector<BenchResult> benchmarkBook(size_t size) {
+    vector<BenchResult> results;
+    string path = STORE_FILE + ".bench";
+    mt19937 rng(static_cast<uint32_t>(size));
+    vector<Contact> rows = generateBook(size, static_cast<uint32_t>(size) + 1);
+
+    // Inputs are prepared up front so they are not timed
+    size_t changes = min<size_t>(10000, max<size_t>(1, size / 4));
+    vector<string> queries, victims, pages; // pages: page numbers for list
+    size_t listed = 0;
+    vector<array<string, 3>> additions;
+    for (size_t i = 0; i < 1000 && size > 0; ++i) {
+        string_view name = rows[rng() % size].getName();
+        queries.emplace_back(name.substr(rng() % (name.size() - 2), 3));
+    }
+    for (size_t i = 0; i < 1000 && size > 0; ++i) {
+        size_t first = rng() % size / LIST_PAGE_SIZE * LIST_PAGE_SIZE;
+        pages.push_back(to_string(first / LIST_PAGE_SIZE + 1));
+        listed += min(LIST_PAGE_SIZE, size - first);
+    }
+    for (size_t i = 0; i < changes && size > 0; ++i) victims.emplace_back(rows[rng() % size].getPhone());
+    for (size_t i = 0; i < changes; ++i) {
+        additions.push_back({ "Added Contact " + to_string(i), to_string(9770000000ULL + i), "added" + to_string(i) + "@bench.com" });
+    }
+
+    ContactBook book;
+    uint64_t lsn = 0;
+    StoreFormat format, userFormat = storeFormat;
+    error_code ec;
+    filesystem::remove(path + ".wal", ec);
+    wal.useFiles(path, path + ".wal");
+    for (StoreFormat layout : { StoreFormat::Blocks, StoreFormat::Plain }) { // The plain load stays as the book
+        string suffix = layout == StoreFormat::Blocks ? "-blocks" : "";
+        storeFormat = layout;
+        measureBench(results, size, "save" + suffix, size, [&] { writeStore(path, rows, 0); });
+        measureBench(results, size, "load" + suffix, size, [&] {
+            vector<Contact> loaded;
+            readStore(path, loaded, lsn, false, format);
+            book.assign(move(loaded));
+        });
+    }
+    storeFormat = userFormat;
+    vector<Contact>().swap(rows);
+    wal.replay(book, lsn); // Starts the persistence thread on the empty scratch log
+
+    measureBench(results, size, "index", size, [&] { book.buildIndexes(); });
+    measureBench(results, size, "search", queries.size(), [&] {
+        silenced([&] {
+            for (const auto& query : queries) searchContacts(book, query);
+        });
+    });
+    // Pages rendered as the table list shows them; one op is one row
+    vector<string_view> params(1);
+    measureBench(results, size, "list", listed, [&] {
+        silenced([&] {
+            for (const auto& page : pages) {
+                params[0] = page;
+                displayContacts(book, params);
+            }
+        });
+    });
+    params.resize(3);
+    measureBench(results, size, "add", additions.size(), [&] {
+        silenced([&] {
+            for (const auto& row : additions) {
+                params.assign(row.begin(), row.end());
+                addContact(book, params);
+            }
+        });
+    });
+    measureBench(results, size, "delete", victims.size(), [&] {
+        silenced([&] {
+            for (const auto& phone : victims) deleteContact(book, phone);
+        });
+    });
+    measureBench(results, size, "sort", book.size(), [&] { silenced([&] { sortContacts(book); }); });
+    wal.close(); // Waits for the snapshot the sort queued, which views the book's fields
+    filesystem::remove(path, ec);
+    filesystem::remove(path + ".wal", ec);
+    return results;
+}
+
+// Value of "key": in one of the benchmark's own JSON lines (flat numbers and strings only)
+string benchField(const string& line, const string& key) {
+    size_t at = line.find("\"" + key + "\":");
+    if (at == string::npos) return "";
+    at += key.size() + 3;
+    if (at < line.size() && line[at] == '"') return line.substr(at + 1, line.find('"', at + 1) - at - 1);
+    return line.substr(at, line.find_first_of(",}", at) - at);
+}
+
+// Run the benchmark suite for each size and print one JSON line per operation:
+//   {"size":1000,"op":"search","ops":1000,"ns_per_op":812.4,"allocs_per_op":0.00,"peak_rss_kib":5120}
+// With a baseline file (the output of an earlier run), each line also carries the baseline time and
+// the change; a result slower than tolerance percent, or allocating more, counts as a regression
+// and makes the exit status 1. savePath stores this run's lines as the next baseline.
+int runBenchmarks(const vector<size_t>& sizes, const string& baselinePath, const string& savePath, double tolerance) {
+    map<pair<size_t, string>, pair<double, double>> baseline; // (size, op) -> ns/op, allocs/op
+    if (!baselinePath.empty()) {
+        ifstream file(baselinePath);
+        if (!file.is_open()) {
+            string error = "{\"error\":";
+            appendJsonString(error, "Cannot open " + baselinePath);
+            term << error << "}\n";
+            return 1;
+        }
+        string line;
+        while (getline(file, line)) {
+            string op = benchField(line, "op"), ns = benchField(line, "ns_per_op");
+            if (op.empty() || ns.empty()) continue;
+            baseline[{ strtoull(benchField(line, "size").c_str(), nullptr, 10), op }] = { atof(ns.c_str()), atof(benchField(line, "allocs_per_op").c_str()) };
+        }
+    }
+
+    string saved;
+    size_t regressions = 0, measured = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t size : sizes) {
+        // Small books run several times and keep each operation's best time, which is far less
+        // noisy than a single short run
+        vector<BenchResult> best;
+        for (size_t run = 0, runs = max<size_t>(1, min<size_t>(20, 1000000 / size)); run < runs; ++run) {
+            vector<BenchResult> results = benchmarkBook(size);
+            contactArena.renew(); // The synthetic book is gone; release its field bytes
+            if (best.empty()) {
+                best = move(results);
+                continue;
+            }
+            for (size_t i = 0; i < best.size(); ++i) {
+                best[i].nsPerOp = min(best[i].nsPerOp, results[i].nsPerOp);
+                best[i].peakRssKib = max(best[i].peakRssKib, results[i].peakRssKib);
+            }
+        }
+        for (const auto& result : best) {
+            char line[256];
+            snprintf(line, sizeof(line), "{\"size\":%zu,\"op\":\"%s\",\"ops\":%zu,\"ns_per_op\":%.1f,\"allocs_per_op\":%.2f,\"peak_rss_kib\":%zu",
+                     result.size, result.op.c_str(), result.ops, result.nsPerOp, result.allocsPerOp, result.peakRssKib);
+            string out = line;
+            saved += out + "}\n";
+            auto base = baseline.find({ result.size, result.op });
+            if (base != baseline.end()) {
+                double change = (result.nsPerOp / max(base->second.first, 0.1) - 1) * 100;
+                bool regression = change > tolerance || result.allocsPerOp > base->second.second * 1.01 + 0.01;
+                regressions += regression;
+                snprintf(line, sizeof(line), ",\"baseline_ns_per_op\":%.1f,\"change_pct\":%.1f,\"regression\":%s",
+                         base->second.first, change, regression ? "true" : "false");
+                out += line;
+            }
+            term << out << "}\n";
+            ++measured;
+        }
+        term.flush();
+    }
+    if (!savePath.empty()) {
+        ofstream file(savePath, ios::trunc);
+        if (!(file << saved)) {
+            string error = "{\"error\":";
+            appendJsonString(error, "Cannot write " + savePath);
+            term << error << "}\n";
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    term << "{\"summary\":{\"results\":" << measured << ",\"regressions\":" << regressions << ",\"seconds\":" << terminal::fixed(seconds, 1) << "}}\n";
+    return regressions > 0 ? 1 : 0;
+}
+
+// Inputs at the edges of the original patterns: empty, one short of and at the length limits,
+// signs, spaces and other bytes the patterns exclude, and misplaced '@' and dots. Very long
+// fields are added by checkValidators().
+const char* const PHONE_EDGE_CASES[] = { "", "-", "1234567", "12345678", "+12345678", "+1234567890", " 12345678",
+    "12345678 ", "1234 5678", "1234-5678", "(123)45678", "12345678\n", "0000000000", "1234567a", "a12345678",
+    "\xd9\xa1\xd9\xa2\xd9\xa3\xd9\xa4\xd9\xa5\xd9\xa6\xd9\xa7\xd9\xa8" };
+const char* const EMAIL_EDGE_CASES[] = { "", "-", "@", "a@", "@b.com", "a@b", "a@b.c", "a@b.co", "a@b.c0", "a@b.co1",
+    "a@b.c-m", "a@b.COM", "A@B.Co", "a@b.com.", "a@b..co", "a@..co", "a@.com", "a@.co.uk", "a@-b.com", "a@b-.com",
+    "a@b_c.com", "a@1.23", "a@b.c.d", "a@b.c.de", ".a@b.com", "a.@b.com", "a..b@c.com", "+@b.cc", "%@b.cc",
+    "a b@c.com", "a@b c.com", "a@b@c.com", "a@b.com@", "a@b.co\n", " a@b.co", "a@b.co ", "\xc3\xa9@b.co",
+    "a@\xc3\xa9.co", "a@b.c\xc3\xa9" };
+
+// Check the DFA validators against the reference regexes, first on the edge cases and then on a
+// random corpus of count inputs each, and time both; the exit status is 1 if they ever disagree
+int checkValidators(size_t count) {
+    const regex phoneRegex(PHONE_PATTERN), emailRegex(EMAIL_PATTERN);
+    vector<string> phoneEdges(begin(PHONE_EDGE_CASES), end(PHONE_EDGE_CASES));
+    vector<string> emailEdges(begin(EMAIL_EDGE_CASES), end(EMAIL_EDGE_CASES));
+    phoneEdges.insert(phoneEdges.end(), { string(15, '9'), string(16, '9'), string(10000, '1') });
+    emailEdges.insert(emailEdges.end(), { string(64, 'a') + "@" + string(63, 'b') + ".com", string(10000, 'a') + "@b.org",
+                                          "a@" + string(10000, 'b') + ".co", "a@b." + string(10000, 'c') });
+    size_t edgeMismatches = 0;
+    auto checkEdges = [&edgeMismatches](const char* kind, const vector<string>& inputs, const auto& dfa, const regex& pattern) {
+        for (const string& input : inputs) {
+            bool accepted = dfa.matches(input);
+            if (accepted == regex_match(input, pattern)) continue;
+            ++edgeMismatches;
+            setColor(RED);
+            term << kind << " \"" << (input.size() > 40 ? input.substr(0, 40) + "..." : input) << "\": DFA "
+                 << (accepted ? "accepts, regex rejects\n" : "rejects, regex accepts\n");
+            setColor(WHITE);
+        }
+    };
+    checkEdges("phone", phoneEdges, PHONE_DFA, phoneRegex);
+    checkEdges("email", emailEdges, EMAIL_DFA, emailRegex);
+    size_t edgeCount = phoneEdges.size() + emailEdges.size();
+    if (edgeMismatches == 0) { setColor(GREEN); term << "DFA and regex agree on all " << edgeCount << " edge cases\n"; }
+    else { setColor(RED); term << edgeMismatches << " of " << edgeCount << " edge cases disagree!\n"; }
+    setColor(WHITE);
+
+    mt19937 rng(20250220);
+    const string alphabet = "abcxyzABZ0189._%+-@ #";
+    vector<string> phones, emails;
+    phones.reserve(count);
+    emails.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        string phone(6 + rng() % 12, '0');
+        for (auto& c : phone) c = '0' + rng() % 10;
+        if (rng() % 4 == 0) phone[rng() % phone.size()] = alphabet[rng() % alphabet.size()]; // Near misses
+        phones.push_back(move(phone));
+
+        string email;
+        size_t length = 3 + rng() % 20;
+        for (size_t j = 0; j < length; ++j) email += alphabet[rng() % alphabet.size()];
+        if (rng() % 2 == 0) email = "user" + to_string(i) + "@mail" + to_string(rng() % 100) + (rng() % 3 ? ".com" : ".c0"); // Mostly valid shapes
+        emails.push_back(move(email));
+    }
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (PHONE_DFA.matches(phones[i]) != regex_match(phones[i], phoneRegex)) ++mismatches;
+        if (EMAIL_DFA.matches(emails[i]) != regex_match(emails[i], emailRegex)) ++mismatches;
+    }
+
+    auto time = [count](auto check) {
+        auto start = chrono::steady_clock::now();
+        size_t accepted = check();
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / count;
+        return make_pair(ns, accepted);
+    };
+    auto regexPhone = time([&] { size_t n = 0; for (const auto& p : phones) n += regex_match(p, phoneRegex); return n; });
+    auto dfaPhone = time([&] { size_t n = 0; for (const auto& p : phones) n += PHONE_DFA.matches(p); return n; });
+    auto regexEmail = time([&] { size_t n = 0; for (const auto& e : emails) n += regex_match(e, emailRegex); return n; });
+    auto dfaEmail = time([&] { size_t n = 0; for (const auto& e : emails) n += EMAIL_DFA.matches(e); return n; });
+
+    setColor(CYAN); term << "\nValidator benchmark over " << count << " phones and " << count << " emails\n";
+    setColor(WHITE);
+    term << "  " << terminal::pad("phone", 8) << "regex " << terminal::fixed(regexPhone.first, 1, 10) << "ns  dfa " << terminal::fixed(dfaPhone.first, 1, 8)
+         << "ns  speedup " << terminal::fixed(regexPhone.first / max(dfaPhone.first, 0.01), 1) << "x  (" << dfaPhone.second << " valid)\n";
+    term << "  " << terminal::pad("email", 8) << "regex " << terminal::fixed(regexEmail.first, 1, 10) << "ns  dfa " << terminal::fixed(dfaEmail.first, 1, 8)
+         << "ns  speedup " << terminal::fixed(regexEmail.first / max(dfaEmail.first, 0.01), 1) << "x  (" << dfaEmail.second << " valid)\n";
+    if (regexPhone.second != dfaPhone.second || regexEmail.second != dfaEmail.second) ++mismatches;
+    if (mismatches == 0) { setColor(GREEN); term << "DFA and regex agree on all " << 2 * count << " random inputs\n"; }
+    else { setColor(RED); term << mismatches << " random inputs where DFA and regex disagree!\n"; }
+    setColor(WHITE);
+    return edgeMismatches + mismatches == 0 ? 0 : 1;
+}
+
+// Run the benchmark suite or the validator check
+int main(int argc, char* argv[]) {
+    vector<size_t> benchSizes;  // --bench [sizes]: book sizes to measure
+    size_t validatorChecks = 0; // --check-validators [count]: compare the validators with the regexes
+    string baselinePath, saveBaselinePath;
+    double tolerance = 25;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--bench") {
+            string list = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : "1000,100000,10000000";
+            stringstream items(list);
+            string item;
+            while (getline(items, item, ',')) {
+                if (!item.empty()) benchSizes.push_back(max(1UL, strtoul(item.c_str(), nullptr, 10)));
+            }
+        }
+        else if (arg == "--check-validators") {
+            validatorChecks = i + 1 < argc && argv[i + 1][0] != '-' ? max(1UL, strtoul(argv[++i], nullptr, 10)) : 100000;
+        }
+        else if (arg.rfind("--baseline=", 0) == 0) baselinePath = arg.substr(11);
+        else if (arg.rfind("--save-baseline=", 0) == 0) saveBaselinePath = arg.substr(16);
+        else if (arg.rfind("--tolerance=", 0) == 0) tolerance = atof(arg.c_str() + 12);
+        else if (arg == "--simd=scalar" || arg == "--simd=sse2" || arg == "--simd=avx2") scan = selectKernels(arg.substr(7));
+        else if (arg.rfind("--simd=", 0) == 0) {
+            setColor(RED); term << "Unknown --simd level '" << arg.substr(7) << "' (use scalar, sse2 or avx2)\n"; setColor(WHITE);
+            return 1;
+        }
+        else if (arg.rfind("--threads=", 0) == 0) searchThreads = strtoul(arg.c_str() + 10, nullptr, 10);
+    }
+    if (validatorChecks > 0) return checkValidators(validatorChecks);
+    if (benchSizes.empty()) {
+        setColor(RED);
+        term << "Usage: phonebook-bench --bench [sizes] [--baseline=<file>] [--save-baseline=<file>] [--tolerance=<percent>]\n"
+             << "       phonebook-bench --check-validators [count]\n";
+        setColor(WHITE);
+        return 1;
+    }
+    term.setColorEnabled(false);
+    return runBenchmarks(benchSizes, baselinePath, saveBaselinePath, tolerance);
+}
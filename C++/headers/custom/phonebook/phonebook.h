@@ -0,0 +1,4103 @@
+/**
+ * phonebook.h
+ *
+ * The contact book behind the Phonebook CLI, shared by its two programs: phonebook.cpp (the CLI,
+ * batch mode and server) and phonebook_bench.cpp (the benchmark suite). It holds the contacts and
+ * their string arena, the search indexes, the store formats, the write-ahead log, the startup
+ * cache and the commands that run against a book.
+ *
+ * Like terminal.h it defines everything it declares. Each program is a single translation unit
+ * that includes it once, after defining PHONEBOOK_SOURCE as its own __FILE__: the book's files
+ * are kept next to that file, and with --embedded the book lives in its data section.
+ *
+ * Author: Upendra237
+ * License: MIT
+ */
+
+#ifndef CUSTOM_PHONEBOOK_H
+#define CUSTOM_PHONEBOOK_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <cctype>
+#include <array>
+#include <random>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <string_view>
+#include <memory>
+#include <deque>
+#include <cstring>
+#include <cerrno>
+#include <unordered_map>
+#include <chrono>
+#include <future>
+#include <functional>
+#include <condition_variable>
+#include <shared_mutex>
+#include <map>
+#include <new>
+#include <cstdlib>
+#include <charconv>
+#include <optional>
+#include <numeric>
+#include "../terminal/terminal.h"
+
+// Platform-specific definitions for screen clearing
+#ifdef _WIN32
+    #define CLEAR_COMMAND "cls"
+#else
+    #define CLEAR_COMMAND "clear"
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+using namespace std;
+
+// Console output goes through the shared terminal writer: one buffer flushed with a single write,
+// redundant color changes elided, and no color codes at all when stdout is not a terminal
+terminal::Output& term = terminal::out();
+void setColor(terminal::Color color) { term << color; }
+const terminal::Color RED = terminal::Color::Red;
+const terminal::Color GREEN = terminal::Color::Green;
+const terminal::Color YELLOW = terminal::Color::Yellow;
+const terminal::Color BLUE = terminal::Color::Blue;
+const terminal::Color MAGENTA = terminal::Color::Magenta;
+const terminal::Color CYAN = terminal::Color::Cyan;
+const terminal::Color WHITE = terminal::Color::White;
+const terminal::Color DARK_YELLOW = terminal::Color::Yellow;
+const terminal::Color LIGHT_GRAY = terminal::Color::Gray;
+const terminal::Color LIGHT_CYAN = terminal::Color::LightCyan;
+
+// Flush pending output before handing the screen to the shell's clear command
+void clearScreen() {
+    term.flush();
+    system(CLEAR_COMMAND);
+}
+
+// Scan kernels: substring search and the name character-class check in vectorized (SSE2, AVX2)
+// and scalar versions. The widest level the CPU supports is picked once at startup (GCC/Clang on x86;
+// other targets use the scalar kernels), and --simd=scalar|sse2|avx2 can force a lower one. Only
+// ContactTable's column scans are long enough to reach the vector find kernels; contact fields
+// searched by the book stay below findIn's 64-byte cutoff.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    #define PHONEBOOK_SIMD 1
+    #include <immintrin.h>
+#endif
+
+const size_t NOT_FOUND = string_view::npos;
+
+size_t findScalar(const char* text, size_t length, const char* needle, size_t needleLength) {
+    return string_view(text, length).find(string_view(needle, needleLength));
+}
+
+bool isNameChar(char c) {
+    char lower = c | 0x20;
+    return (lower >= 'a' && lower <= 'z') || (c >= '0' && c <= '9') || c == ' ' || c == '-' || c == '\'';
+}
+
+bool allNameCharsScalar(const char* text, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        if (!isNameChar(text[i])) return false;
+    }
+    return true;
+}
+
+#ifdef PHONEBOOK_SIMD
+// Compare the needle's first and last byte against a whole block of positions at once and only
+// memcmp the middle at positions where both agree (Mula's "generic SIMD" substring search)
+__attribute__((target("sse2")))
+size_t findSse2(const char* text, size_t length, const char* needle, size_t needleLength) {
+    if (needleLength < 2 || needleLength > length) return findScalar(text, length, needle, needleLength);
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needleLength - 1]);
+    size_t i = 0;
+    for (; i + needleLength - 1 + 16 <= length; i += 16) {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + needleLength - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast)));
+        for (; mask != 0; mask &= mask - 1) {
+            unsigned bit = __builtin_ctz(mask);
+            if (memcmp(text + i + bit + 1, needle + 1, needleLength - 2) == 0) return i + bit;
+        }
+    }
+    size_t tail = findScalar(text + i, length - i, needle, needleLength);
+    return tail == NOT_FOUND ? NOT_FOUND : i + tail;
+}
+
+__attribute__((target("avx2")))
+size_t findAvx2(const char* text, size_t length, const char* needle, size_t needleLength) {
+    if (needleLength < 2 || needleLength > length) return findScalar(text, length, needle, needleLength);
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needleLength - 1]);
+    size_t i = 0;
+    for (; i + needleLength - 1 + 32 <= length; i += 32) {
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+        __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i + needleLength - 1));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast)));
+        for (; mask != 0; mask &= mask - 1) {
+            unsigned bit = __builtin_ctz(mask);
+            if (memcmp(text + i + bit + 1, needle + 1, needleLength - 2) == 0) return i + bit;
+        }
+    }
+    size_t tail = findSse2(text + i, length - i, needle, needleLength);
+    return tail == NOT_FOUND ? NOT_FOUND : i + tail;
+}
+
+// Byte-wise unsigned "low <= x <= high" as a mask of 0xFF lanes
+__attribute__((target("sse2")))
+inline __m128i inRange(__m128i x, char low, char high) {
+    __m128i shifted = _mm_sub_epi8(x, _mm_set1_epi8(low));
+    __m128i span = _mm_set1_epi8(static_cast<char>(high - low));
+    return _mm_cmpeq_epi8(_mm_min_epu8(shifted, span), shifted);
+}
+
+__attribute__((target("sse2")))
+bool allNameCharsSse2(const char* text, size_t length) {
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        __m128i ok = _mm_or_si128(inRange(_mm_or_si128(block, _mm_set1_epi8(0x20)), 'a', 'z'), inRange(block, '0', '9'));
+        ok = _mm_or_si128(ok, _mm_cmpeq_epi8(block, _mm_set1_epi8(' ')));
+        ok = _mm_or_si128(ok, _mm_cmpeq_epi8(block, _mm_set1_epi8('-')));
+        ok = _mm_or_si128(ok, _mm_cmpeq_epi8(block, _mm_set1_epi8('\'')));
+        if (_mm_movemask_epi8(ok) != 0xFFFF) return false;
+    }
+    return allNameCharsScalar(text + i, length - i);
+}
+#endif
+
+struct ScanKernels {
+    const char* level;
+    size_t (*find)(const char*, size_t, const char*, size_t);
+    bool (*allNameChars)(const char*, size_t);
+};
+
+ScanKernels selectKernels(const string& requested) {
+    ScanKernels kernels = { "scalar", findScalar, allNameCharsScalar };
+#ifdef PHONEBOOK_SIMD
+    __builtin_cpu_init();
+    if (requested != "scalar" && __builtin_cpu_supports("sse2")) {
+        kernels = { "sse2", findSse2, allNameCharsSse2 };
+        if (requested != "sse2" && __builtin_cpu_supports("avx2")) kernels.level = "avx2", kernels.find = findAvx2;
+    }
+#endif
+    return kernels;
+}
+
+ScanKernels scan = selectKernels("");
+
+// Short fields are searched inline: a vector kernel only pays off once there are a few blocks to scan
+size_t findIn(string_view text, string_view needle) {
+    if (text.size() < 64) return text.find(needle);
+    return scan.find(text.data(), text.size(), needle.data(), needle.size());
+}
+
+// Append-only storage for contact strings. Contacts hold string_views into it, so a contact costs
+// no heap allocation of its own. Bytes are kept in generations: renew() starts a new one, and an
+// older generation is freed once nothing pins it any more. Books pin the generations they view and
+// copy their contacts into a new one when they purge tombstones, which frees deleted contacts'
+// bytes while the program runs.
+class StringArena {
+private:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+    struct Generation {
+        vector<unique_ptr<char[]>> chunks;
+        deque<string> buffers; // Whole-file buffers handed over by adopt()
+    };
+    shared_ptr<Generation> current = make_shared<Generation>();
+    size_t used = 0, capacity = 0;
+
+public:
+    using Pin = shared_ptr<const void>;
+
+    string_view store(string_view text) {
+        if (text.empty()) return string_view();
+        if (text.size() > capacity - used) {
+            capacity = max(CHUNK_SIZE, text.size());
+            current->chunks.emplace_back(new char[capacity]);
+            used = 0;
+        }
+        char* dest = current->chunks.back().get() + used;
+        memcpy(dest, text.data(), text.size());
+        used += text.size();
+        return string_view(dest, text.size());
+    }
+
+    // Keep a buffer alive with the current generation so contacts can view into it without copying
+    string_view adopt(string&& buffer) {
+        current->buffers.push_back(move(buffer));
+        return current->buffers.back();
+    }
+
+    // While held, the current generation and every view stored in it stay valid
+    Pin pin() const { return current; }
+
+    // Store into a new generation from now on; the current one goes once no pin holds it
+    void renew() {
+        current = make_shared<Generation>();
+        used = capacity = 0;
+    }
+};
+
+StringArena contactArena;
+
+// Read-only memory mapping of a file; falls back to reading it into memory where mmap is unavailable
+class MappedFile {
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    string fallback;
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    void close() {
+#ifndef _WIN32
+        if (data && fallback.empty()) munmap(const_cast<char*>(data), size);
+#endif
+        data = nullptr;
+        size = 0;
+        fallback.clear();
+    }
+
+    bool open(const string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                madvise(mapped, info.st_size, MADV_SEQUENTIAL); // Records are parsed front to back
+                data = static_cast<const char*>(mapped);
+                size = info.st_size;
+            }
+        }
+        ::close(fd);
+        return data != nullptr;
+#else
+        ifstream file(path, ios::binary);
+        if (!file.is_open()) return false;
+        fallback.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        data = fallback.data();
+        size = fallback.size();
+        return !fallback.empty();
+#endif
+    }
+
+    string_view view() const { return string_view(data, size); }
+
+    // Drop the resident whole pages of a range; reading there again faults them back in from the file
+    void release(size_t offset, size_t length = SIZE_MAX) {
+#ifndef _WIN32
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t start = (offset + page - 1) / page * page;
+        size_t end = length >= size - min(offset, size) ? size : (offset + length) / page * page;
+        if (data && fallback.empty() && start < end) madvise(const_cast<char*>(data) + start, end - start, MADV_DONTNEED);
+#else
+        (void)offset;
+        (void)length;
+#endif
+    }
+};
+
+MappedFile storeMapping; // Backs the contacts of a --mmap load, must outlive them
+
+// Raw images of in-memory arrays, used by the startup cache. They keep this machine's own layout,
+// so loading an array is one copy; the cache records its byte order and is only read where it matches.
+template <typename Emit>
+void emitNumber(Emit& emit, uint64_t value) {
+    emit(string_view(reinterpret_cast<const char*>(&value), sizeof(value)));
+}
+
+template <typename Emit, typename T>
+void emitArray(Emit& emit, const vector<T>& items) {
+    static_assert(is_trivially_copyable<T>::value, "arrays are written as raw bytes");
+    emitNumber(emit, items.size());
+    emit(string_view(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T)));
+}
+
+// An array of an image read in place, for arrays that are only read once while loading
+template <typename T>
+class ImageArray {
+private:
+    const char* data = nullptr;
+    size_t count = 0;
+
+public:
+    ImageArray() = default;
+    ImageArray(const char* data, size_t count) : data(data), count(count) {}
+
+    size_t size() const { return count; }
+    const char* bytes() const { return data; }
+    T operator[](size_t i) const {
+        T item;
+        memcpy(&item, data + i * sizeof(T), sizeof(T)); // Image arrays need not be aligned
+        return item;
+    }
+};
+
+// Reads an image back in the order it was emitted; running past the end marks the reader failed.
+// Given the mapping the image lies in, it releases the pages it has moved past as it goes, so a
+// large image is never resident all at once besides what the caller keeps.
+class ImageReader {
+private:
+    string_view data;
+    size_t pos = 0;
+    size_t keptEnd = 0;
+    bool failed = false;
+    MappedFile* mapping;
+    size_t released = 0;
+
+public:
+    explicit ImageReader(string_view data, MappedFile* mapping = nullptr) : data(data), mapping(mapping) {}
+
+    bool ok() const { return !failed; }
+    bool atEnd() const { return !failed && pos == data.size(); }
+
+    // The next length bytes; with keep set the caller holds on to views of them
+    string_view bytes(size_t length, bool keep = false) {
+        if (failed || data.size() - pos < length) {
+            failed = true;
+            return string_view();
+        }
+        string_view result = data.substr(pos, length);
+        pos += length;
+        if (keep) keptEnd = pos;
+        return result;
+    }
+
+    // The caller is done with everything read so far except the kept bytes: given a mapping, its
+    // pages are dropped so a large image is never resident all at once
+    void consumed() {
+        size_t from = max(released, keptEnd);
+        if (mapping && from < pos) mapping->release(data.data() - mapping->view().data() + from, pos - from);
+        released = max(released, pos);
+    }
+
+    uint64_t number() {
+        uint64_t value = 0;
+        string_view raw = bytes(sizeof(value));
+        if (!failed) memcpy(&value, raw.data(), sizeof(value));
+        return value;
+    }
+
+    template <typename T>
+    bool array(ImageArray<T>& items) {
+        uint64_t count = number();
+        if (failed || count > (data.size() - pos) / sizeof(T)) {
+            failed = true;
+            return false;
+        }
+        items = ImageArray<T>(bytes(count * sizeof(T)).data(), count);
+        return true;
+    }
+
+    template <typename T>
+    bool array(vector<T>& items) {
+        ImageArray<T> raw;
+        if (!array(raw)) return false;
+        items.resize(raw.size());
+        if (raw.size() > 0) memcpy(items.data(), raw.bytes(), raw.size() * sizeof(T));
+        return true;
+    }
+};
+
+// Class to represent a contact
+class Contact {
+private:
+    string_view name;   // Contact name
+    string_view phone;  // Contact phone number
+    string_view email;  // Contact email address
+
+    struct NoCopy {};
+    Contact(NoCopy, string_view n, string_view p, string_view e) : name(n), phone(p), email(e) {}
+
+public:
+    Contact(string_view n = "Unknown", string_view p = "0000000000", string_view e = "unknown@none.com") 
+        : name(contactArena.store(n)), phone(contactArena.store(p)), email(contactArena.store(e)) {} // Copies fields into the arena
+
+    // Non-owning contact over bytes that outlive it, such as the memory-mapped store
+    static Contact view(string_view n, string_view p, string_view e) { return Contact(NoCopy{}, n, p, e); }
+    
+    // Getter methods
+    string_view getName() const { return name; }
+    string_view getPhone() const { return phone; }
+    string_view getEmail() const { return email; }
+    
+    // Setter methods with default value handling
+    void setName(string_view n) { name = contactArena.store(n == "-" ? "Unknown" : n); }
+    void setPhone(string_view p) { phone = contactArena.store(p == "-" ? "0000000000" : p); }
+    void setEmail(string_view e) { email = contactArena.store(e == "-" ? "unknown@none.com" : e); }
+    
+    // Append the contact as name:phone:email (the legacy data section format) without temporaries
+    void appendTo(string& out) const {
+        out.append(name).append(1, ':').append(phone).append(1, ':').append(email);
+    }
+};
+
+// Open-addressing hash index from one contact field to the contact ids holding that value.
+// Ids sharing a value are chained through `next`, and each bucket counts its live ids, so an
+// insert, an existence check and the walk over exact matches never scan the whole book.
+class FieldIndex {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+private:
+    struct Bucket {
+        string_view key;
+        uint32_t head = NONE; // Most recently inserted id with this key, NONE for an empty bucket
+        uint32_t live = 0;    // Ids in the chain that are not deleted
+    };
+    vector<Bucket> buckets;  // Power-of-two sized, linear probing
+    vector<uint32_t> next;   // Next id with the same key, indexed by id
+    size_t usedBuckets = 0;
+
+    size_t find(string_view key) const {
+        size_t mask = buckets.size() - 1;
+        size_t slot = hash<string_view>()(key) & mask;
+        while (buckets[slot].head != NONE && buckets[slot].key != key) slot = (slot + 1) & mask;
+        return slot;
+    }
+
+    void grow() {
+        vector<Bucket> old = move(buckets);
+        buckets.assign(max<size_t>(16, old.size() * 2), Bucket());
+        for (const auto& bucket : old) {
+            if (bucket.head != NONE) buckets[find(bucket.key)] = bucket;
+        }
+    }
+
+public:
+    FieldIndex() { buckets.resize(16); }
+
+    void clear(size_t expected) {
+        size_t capacity = 16;
+        while (capacity * 7 < expected * 10) capacity *= 2;
+        buckets.assign(capacity, Bucket());
+        next.clear();
+        next.reserve(expected);
+        usedBuckets = 0;
+    }
+
+    void insert(string_view key, uint32_t id) {
+        if ((usedBuckets + 1) * 10 > buckets.size() * 7) grow(); // Keep load factor under 0.7
+        if (next.size() <= id) next.resize(id + 1, NONE);
+        Bucket& bucket = buckets[find(key)];
+        if (bucket.head == NONE) {
+            bucket.key = key;
+            ++usedBuckets;
+        }
+        next[id] = bucket.head;
+        bucket.head = id;
+        ++bucket.live;
+    }
+
+    // One contact with this key was deleted; its id stays chained until the next rebuild
+    void erase(string_view key) {
+        Bucket& bucket = buckets[find(key)];
+        if (bucket.head != NONE && bucket.live > 0) --bucket.live;
+    }
+
+    uint32_t count(string_view key) const {
+        const Bucket& bucket = buckets[find(key)];
+        return bucket.head == NONE ? 0 : bucket.live;
+    }
+
+    // Visit every id ever inserted with this key (deleted ones included), newest first
+    template <typename Visit>
+    void forEach(string_view key, Visit visit) const {
+        const Bucket& bucket = buckets[find(key)];
+        if (bucket.head == NONE || bucket.live == 0) return;
+        for (uint32_t id = bucket.head; id != NONE; id = next[id]) visit(id);
+    }
+
+    // Image for the startup cache: each bucket's head and live count, where its key lies in the
+    // book's field bytes (keyAt gives the offset of the head's field), then the chains. Loading
+    // then reads every array front to back instead of visiting the contacts in hash order.
+    template <typename Emit, typename KeyAt>
+    void save(Emit& emit, KeyAt keyAt) const {
+        vector<uint32_t> heads(buckets.size() * 2), keyLengths(buckets.size());
+        vector<uint64_t> keyOffsets(buckets.size());
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            heads[2 * i] = buckets[i].head;
+            heads[2 * i + 1] = buckets[i].live;
+            if (buckets[i].head == NONE) continue;
+            keyOffsets[i] = keyAt(buckets[i].head);
+            keyLengths[i] = buckets[i].key.size();
+        }
+        emitArray(emit, heads);
+        emitArray(emit, keyOffsets);
+        emitArray(emit, keyLengths);
+        emitArray(emit, next);
+    }
+
+    // Restore a saved image; keys become views of fields, the field bytes of a book of ids slots
+    bool load(ImageReader& in, size_t ids, string_view fields) {
+        ImageArray<uint32_t> heads, keyLengths;
+        ImageArray<uint64_t> keyOffsets;
+        if (!in.array(heads) || !in.array(keyOffsets) || !in.array(keyLengths) || !in.array(next) || next.size() > ids) return false;
+        size_t capacity = heads.size() / 2;
+        if (capacity < 16 || (capacity & (capacity - 1)) != 0 || keyOffsets.size() != capacity || keyLengths.size() != capacity) return false;
+        buckets.assign(capacity, Bucket());
+        usedBuckets = 0;
+        for (size_t i = 0; i < capacity; ++i) {
+            Bucket& bucket = buckets[i];
+            bucket.head = heads[2 * i];
+            bucket.live = heads[2 * i + 1];
+            if (bucket.head == NONE) continue;
+            if (bucket.head >= ids || keyOffsets[i] > fields.size() || keyLengths[i] > fields.size() - keyOffsets[i]) return false;
+            bucket.key = fields.substr(keyOffsets[i], keyLengths[i]);
+            ++usedBuckets;
+        }
+        return true;
+    }
+};
+
+// Trigram inverted index for substring search over name, phone and email. Every trigram maps to
+// the ascending ids of contacts containing it in any field, so a query of three or more characters
+// only has to check the ids present in all of its trigrams' lists. Ids of deleted contacts stay
+// listed until the book purges its tombstones; callers skip them.
+class TrigramIndex {
+private:
+    unordered_map<uint32_t, vector<uint32_t>> postings;
+    vector<uint32_t> scratch; // Trigrams of the contact being inserted
+
+    static uint32_t gram(const char* p) {
+        return static_cast<uint32_t>(static_cast<unsigned char>(p[0])) << 16 |
+               static_cast<uint32_t>(static_cast<unsigned char>(p[1])) << 8 |
+               static_cast<unsigned char>(p[2]);
+    }
+
+    static void collect(string_view text, vector<uint32_t>& grams) {
+        for (size_t i = 0; i + 3 <= text.size(); ++i) grams.push_back(gram(text.data() + i));
+    }
+
+public:
+    static constexpr size_t MIN_QUERY = 3;
+
+    void clear() { postings.clear(); }
+
+    // Ids must be inserted in ascending order to keep every list sorted
+    void insert(uint32_t id, const Contact& contact) {
+        scratch.clear();
+        collect(contact.getName(), scratch);
+        collect(contact.getPhone(), scratch);
+        collect(contact.getEmail(), scratch);
+        sort(scratch.begin(), scratch.end());
+        scratch.erase(unique(scratch.begin(), scratch.end()), scratch.end());
+        for (uint32_t g : scratch) postings[g].push_back(id);
+    }
+
+    // Fill result with the ascending ids whose fields contain every trigram of query (a superset
+    // of the real matches). The scratch vectors are per thread and keep their capacity, so a
+    // query only allocates while they grow.
+    void candidates(string_view query, vector<uint32_t>& result) const {
+        thread_local vector<uint32_t> grams;
+        thread_local vector<const vector<uint32_t>*> lists;
+        grams.clear();
+        lists.clear();
+        result.clear();
+        collect(query, grams);
+        sort(grams.begin(), grams.end());
+        grams.erase(unique(grams.begin(), grams.end()), grams.end());
+
+        for (uint32_t g : grams) {
+            auto it = postings.find(g);
+            if (it == postings.end()) return;
+            lists.push_back(&it->second);
+        }
+        sort(lists.begin(), lists.end(), [](const vector<uint32_t>* a, const vector<uint32_t>* b) { return a->size() < b->size(); });
+
+        result.assign(lists.front()->begin(), lists.front()->end()); // Intersect starting from the shortest list
+        for (size_t i = 1; i < lists.size() && !result.empty(); ++i) {
+            const vector<uint32_t>& list = *lists[i];
+            result.erase(remove_if(result.begin(), result.end(), [&list](uint32_t id) {
+                return !binary_search(list.begin(), list.end(), id);
+            }), result.end());
+        }
+    }
+
+    // Image for the startup cache: the trigrams, their list lengths, then every list back to back
+    template <typename Emit>
+    void save(Emit& emit) const {
+        vector<uint32_t> grams, lengths;
+        grams.reserve(postings.size());
+        lengths.reserve(postings.size());
+        uint64_t total = 0;
+        for (const auto& posting : postings) {
+            grams.push_back(posting.first);
+            lengths.push_back(posting.second.size());
+            total += posting.second.size();
+        }
+        emitArray(emit, grams);
+        emitArray(emit, lengths);
+        emitNumber(emit, total);
+        for (const auto& posting : postings) {
+            emit(string_view(reinterpret_cast<const char*>(posting.second.data()), posting.second.size() * sizeof(uint32_t)));
+        }
+    }
+
+    bool load(ImageReader& in) {
+        ImageArray<uint32_t> grams, lengths;
+        if (!in.array(grams) || !in.array(lengths) || grams.size() != lengths.size()) return false;
+        uint64_t total = in.number();
+        if (total > SIZE_MAX / sizeof(uint32_t)) return false;
+        string_view lists = in.bytes(total * sizeof(uint32_t));
+        if (!in.ok()) return false;
+        postings.clear();
+        postings.reserve(grams.size());
+        uint64_t at = 0;
+        for (size_t i = 0; i < grams.size(); ++i) {
+            if (lengths[i] > total - at) return false;
+            vector<uint32_t>& list = postings[grams[i]];
+            list.resize(lengths[i]);
+            memcpy(list.data(), lists.data() + at * sizeof(uint32_t), lengths[i] * sizeof(uint32_t));
+            at += lengths[i];
+        }
+        return at == total;
+    }
+};
+
+// Ids ordered by name (ties keep book order). Each entry caches the first eight bytes of the name
+// as a big-endian integer, so most comparisons are one integer compare instead of a string compare
+// through the contact. The order is cut into chunks of at most 2 * CHUNK_ENTRIES entries: an
+// insert binary-searches the chunks by their last entry, then shifts entries within one chunk
+// only, and a full chunk is split in half. Ids of deleted contacts stay listed until the book
+// purges its tombstones; callers skip them.
+class NameIndex {
+private:
+    static constexpr size_t CHUNK_ENTRIES = 1024;
+
+    struct Entry {
+        uint64_t prefix;
+        uint32_t id;
+    };
+    vector<vector<Entry>> chunks; // Consecutive runs of the order, none empty
+
+    static uint64_t prefixKey(string_view name) {
+        uint64_t key = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            key = key << 8 | (i < name.size() ? static_cast<unsigned char>(name[i]) : 0);
+        }
+        return key;
+    }
+
+    // Strict order by (name, id); only names sharing their first eight bytes are compared in full
+    static bool before(const Entry& a, const Entry& b, const vector<Contact>& slots) {
+        if (a.prefix != b.prefix) return a.prefix < b.prefix;
+        int order = slots[a.id].getName().compare(slots[b.id].getName());
+        return order != 0 ? order < 0 : a.id < b.id;
+    }
+
+    // Cut entries, already in order, into chunks of CHUNK_ENTRIES
+    void assignChunks(const vector<Entry>& entries) {
+        chunks.clear();
+        for (size_t at = 0; at < entries.size(); at += CHUNK_ENTRIES) {
+            chunks.emplace_back(entries.begin() + at, entries.begin() + min(entries.size(), at + CHUNK_ENTRIES));
+        }
+    }
+
+public:
+    void clear() { chunks.clear(); }
+
+    // Index every slot; a book that is already in name order (e.g. loaded after a sort) costs one pass
+    void build(const vector<Contact>& slots) {
+        vector<Entry> entries(slots.size());
+        for (uint32_t id = 0; id < slots.size(); ++id) entries[id] = Entry{ prefixKey(slots[id].getName()), id };
+        auto less = [&slots](const Entry& a, const Entry& b) { return before(a, b, slots); };
+        if (!is_sorted(entries.begin(), entries.end(), less)) sort(entries.begin(), entries.end(), less);
+        assignChunks(entries);
+    }
+
+    // id must be the newest slot, so it goes after every contact with the same name
+    void insert(uint32_t id, const vector<Contact>& slots) {
+        Entry entry{ prefixKey(slots[id].getName()), id };
+        if (chunks.empty()) {
+            chunks.emplace_back(1, entry);
+            return;
+        }
+        // The first chunk ending after the new entry holds its place; past every chunk, the last one
+        auto chunk = upper_bound(chunks.begin(), chunks.end(), entry,
+                                 [&slots](const Entry& a, const vector<Entry>& run) { return before(a, run.back(), slots); });
+        if (chunk == chunks.end()) --chunk;
+        chunk->insert(upper_bound(chunk->begin(), chunk->end(), entry,
+                                  [&slots](const Entry& a, const Entry& b) { return before(a, b, slots); }), entry);
+        if (chunk->size() >= 2 * CHUNK_ENTRIES) {
+            vector<Entry> upper(chunk->begin() + CHUNK_ENTRIES, chunk->end());
+            chunk->resize(CHUNK_ENTRIES);
+            chunks.insert(chunk + 1, move(upper));
+        }
+    }
+
+    // Visit ids in name order
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        for (const auto& chunk : chunks) {
+            for (const Entry& entry : chunk) visit(entry.id);
+        }
+    }
+
+    // Visit, in name order, the ids whose name starts with prefix
+    template <typename Visit>
+    void forEachWithPrefix(string_view prefix, const vector<Contact>& slots, Visit visit) const {
+        uint64_t key = prefixKey(prefix);
+        auto earlier = [&](const Entry& entry) { // Orders before every name starting with prefix
+            if (entry.prefix != key) return entry.prefix < key;
+            return slots[entry.id].getName() < prefix;
+        };
+        size_t c = partition_point(chunks.begin(), chunks.end(), [&](const vector<Entry>& run) { return earlier(run.back()); }) - chunks.begin();
+        if (c == chunks.size()) return;
+        size_t at = partition_point(chunks[c].begin(), chunks[c].end(), earlier) - chunks[c].begin();
+        for (; c < chunks.size(); ++c, at = 0) {
+            for (; at < chunks[c].size(); ++at) {
+                uint32_t id = chunks[c][at].id;
+                if (slots[id].getName().compare(0, prefix.size(), prefix) != 0) return;
+                visit(id);
+            }
+        }
+    }
+
+    // Image for the startup cache: the prefix keys and the ids, in order
+    template <typename Emit>
+    void save(Emit& emit) const {
+        vector<uint64_t> prefixes;
+        vector<uint32_t> ids;
+        for (const auto& chunk : chunks) {
+            for (const Entry& entry : chunk) {
+                prefixes.push_back(entry.prefix);
+                ids.push_back(entry.id);
+            }
+        }
+        emitArray(emit, prefixes);
+        emitArray(emit, ids);
+    }
+
+    bool load(ImageReader& in, size_t slotCount) {
+        ImageArray<uint64_t> prefixes;
+        ImageArray<uint32_t> ids;
+        if (!in.array(prefixes) || !in.array(ids) || ids.size() != slotCount || prefixes.size() != slotCount) return false;
+        vector<Entry> entries(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (ids[i] >= slotCount) return false;
+            entries[i] = Entry{ prefixes[i], ids[i] };
+        }
+        assignChunks(entries);
+        return true;
+    }
+};
+
+// BK-tree over case-folded names for typo-tolerant lookup. Each node holds one distinct folded name
+// (the ids carrying it are chained through sameKey), and its children hang off the edit distance
+// to it.
+// By the triangle inequality only children whose edge lies within k of the query's distance to
+// the node can hold a match, so a search computes far fewer distances than there are names.
+// Ids of deleted contacts stay listed until the book purges its tombstones; callers skip them.
+class BkTree {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+private:
+    struct Node {
+        string_view key;          // Folded name, stored in contactArena
+        uint32_t id;              // Most recent contact with this name
+        vector<uint64_t> children; // Distance << 32 | child node, kept together so a lookup is one miss
+    };
+    vector<Node> nodes;
+    vector<uint32_t> sameKey;     // Next id with the same folded name, indexed by id
+
+    static string fold(string_view name) {
+        string folded(name);
+        for (auto& c : folded) c = tolower(static_cast<unsigned char>(c));
+        return folded;
+    }
+
+    // One side of a distance that is compared against many others. Up to 64 characters it uses
+    // Myers' bit-parallel algorithm: bit i of mask[c] marks c at position i, and each character of
+    // the other string updates a whole column of the edit matrix in a few word operations.
+    struct Pattern {
+        string_view text;
+        uint64_t mask[256] = {};
+        mutable vector<uint32_t> row; // Fallback for longer text
+
+        explicit Pattern(string_view text) : text(text) {
+            if (text.size() > 64) return;
+            for (size_t i = 0; i < text.size(); ++i) mask[static_cast<unsigned char>(text[i])] |= 1ULL << i;
+        }
+
+        uint32_t distance(string_view other) const {
+            size_t m = text.size();
+            if (m == 0) return other.size();
+            if (m > 64) return BkTree::distance(text, other, row);
+            uint64_t pv = ~0ULL, mv = 0, top = 1ULL << (m - 1);
+            uint32_t score = m;
+            for (char c : other) {
+                uint64_t eq = mask[static_cast<unsigned char>(c)];
+                uint64_t xv = eq | mv;
+                uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+                uint64_t ph = mv | ~(xh | pv);
+                uint64_t mh = pv & xh;
+                if (ph & top) ++score;
+                else if (mh & top) --score;
+                ph = (ph << 1) | 1;
+                mh <<= 1;
+                pv = mh | ~(xv | ph);
+                mv = ph & xv;
+            }
+            return score;
+        }
+    };
+
+public:
+    // Levenshtein distance using one reusable row
+    static uint32_t distance(string_view a, string_view b, vector<uint32_t>& row) {
+        if (a.size() < b.size()) swap(a, b);
+        row.resize(b.size() + 1);
+        for (uint32_t j = 0; j <= b.size(); ++j) row[j] = j;
+        for (size_t i = 1; i <= a.size(); ++i) {
+            uint32_t diagonal = row[0];
+            row[0] = i;
+            for (size_t j = 1; j <= b.size(); ++j) {
+                uint32_t above = row[j];
+                row[j] = min({ above + 1, row[j - 1] + 1, diagonal + (a[i - 1] != b[j - 1]) });
+                diagonal = above;
+            }
+        }
+        return row[b.size()];
+    }
+
+    void clear() {
+        nodes.clear();
+        sameKey.clear();
+    }
+
+    void insert(uint32_t id, string_view name) {
+        string key = fold(name);
+        Pattern pattern(key);
+        if (sameKey.size() <= id) sameKey.resize(id + 1, NONE);
+        if (nodes.empty()) {
+            nodes.push_back(Node{ contactArena.store(key), id, {} });
+            return;
+        }
+        uint32_t at = 0;
+        while (true) {
+            uint32_t d = pattern.distance(nodes[at].key);
+            if (d == 0) {
+                sameKey[id] = nodes[at].id;
+                nodes[at].id = id;
+                return;
+            }
+            uint32_t child = NONE;
+            for (uint64_t edge : nodes[at].children) {
+                if (edge >> 32 == d) { child = static_cast<uint32_t>(edge); break; }
+            }
+            if (child == NONE) {
+                nodes[at].children.push_back(static_cast<uint64_t>(d) << 32 | nodes.size());
+                nodes.push_back(Node{ contactArena.store(key), id, {} });
+                return;
+            }
+            at = child;
+        }
+    }
+
+    // Visit (distance, id) for every id whose folded name is within k edits of the folded query;
+    // returns how many distances were computed
+    template <typename Visit>
+    size_t search(string_view query, uint32_t k, Visit visit) const {
+        if (nodes.empty()) return 0;
+        string key = fold(query);
+        Pattern pattern(key);
+        vector<uint32_t> pending{ 0 };
+        size_t computed = 0;
+        while (!pending.empty()) {
+            const Node& node = nodes[pending.back()];
+            pending.pop_back();
+            uint32_t d = pattern.distance(node.key);
+            ++computed;
+            if (d <= k) {
+                for (uint32_t id = node.id; id != NONE; id = sameKey[id]) visit(d, id);
+            }
+            for (uint64_t edge : node.children) {
+                uint32_t distance = edge >> 32;
+                if (distance + k >= d && distance <= d + k) pending.push_back(static_cast<uint32_t>(edge));
+            }
+        }
+        return computed;
+    }
+
+    size_t size() const { return nodes.size(); }
+
+    // Image for the startup cache: per node its id, key length and child count, then the keys
+    // and the children back to back, then the same-key chains
+    template <typename Emit>
+    void save(Emit& emit) const {
+        vector<uint32_t> ids, keyLengths, childCounts;
+        vector<uint64_t> children;
+        string keys;
+        for (const Node& node : nodes) {
+            ids.push_back(node.id);
+            keyLengths.push_back(node.key.size());
+            childCounts.push_back(node.children.size());
+            keys.append(node.key.data(), node.key.size());
+            children.insert(children.end(), node.children.begin(), node.children.end());
+        }
+        emitArray(emit, ids);
+        emitArray(emit, keyLengths);
+        emitArray(emit, childCounts);
+        emitNumber(emit, keys.size());
+        emit(keys);
+        emitArray(emit, children);
+        emitArray(emit, sameKey);
+    }
+
+    bool load(ImageReader& in, size_t slotCount) {
+        ImageArray<uint32_t> ids, keyLengths, childCounts;
+        ImageArray<uint64_t> children;
+        if (!in.array(ids) || !in.array(keyLengths) || !in.array(childCounts)) return false;
+        string_view keys = in.bytes(in.number());
+        if (!in.array(children) || !in.array(sameKey) || sameKey.size() > slotCount) return false;
+        if (keyLengths.size() != ids.size() || childCounts.size() != ids.size()) return false;
+        nodes.clear();
+        nodes.reserve(ids.size());
+        size_t keyAt = 0, childAt = 0;
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (keyLengths[i] > keys.size() - keyAt || childCounts[i] > children.size() - childAt) return false;
+            if (ids[i] >= sameKey.size()) return false;
+            nodes.push_back(Node{ contactArena.store(keys.substr(keyAt, keyLengths[i])), ids[i], vector<uint64_t>(childCounts[i]) });
+            if (childCounts[i] > 0) memcpy(nodes.back().children.data(), children.bytes() + childAt * sizeof(uint64_t), childCounts[i] * sizeof(uint64_t));
+            keyAt += keyLengths[i];
+            childAt += childCounts[i];
+        }
+        return keyAt == keys.size() && childAt == children.size();
+    }
+};
+
+// Path-compressed radix-10 trie over phone numbers for caller-ID lookups. Each node holds the run
+// of digits on the edge into it (a view of a phone in the book) and, once it has children, ten
+// direct child slots in a shared pool, so every step is one array index and a lookup costs the
+// length of the number, not the size of the book. Phones with anything but digits are not indexed.
+// Ids sharing a phone are chained through sameKey. Ids of deleted contacts stay listed until the
+// book purges its tombstones; callers skip them.
+class PhoneTrie {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+private:
+    struct Node {
+        const char* label;        // Digits on the edge from the parent
+        uint32_t length;
+        uint32_t id = NONE;       // Most recent contact whose phone ends here
+        uint32_t children = NONE; // First of this node's ten slots in childSlots
+    };
+    vector<Node> nodes;           // nodes[0] is the root, with an empty label
+    vector<uint32_t> childSlots;
+    vector<uint32_t> sameKey;     // Next older id with the same phone, indexed by id
+
+    uint32_t child(uint32_t node, char digit) const {
+        uint32_t first = nodes[node].children;
+        return first == NONE ? NONE : childSlots[first + (digit - '0')];
+    }
+
+    void setChild(uint32_t node, char digit, uint32_t to) {
+        if (nodes[node].children == NONE) {
+            nodes[node].children = childSlots.size();
+            childSlots.resize(childSlots.size() + 10, NONE);
+        }
+        childSlots[nodes[node].children + (digit - '0')] = to;
+    }
+
+    uint32_t addNode(const char* label, uint32_t length) {
+        nodes.push_back(Node{ label, length });
+        return nodes.size() - 1;
+    }
+
+    // Ids ending at node, oldest (book order) first
+    template <typename Visit>
+    void visitIds(uint32_t node, Visit visit) const {
+        uint32_t id = nodes[node].id;
+        if (id == NONE) return;
+        if (sameKey[id] == NONE) { visit(id); return; }
+        vector<uint32_t> ids;
+        for (; id != NONE; id = sameKey[id]) ids.push_back(id);
+        for (auto it = ids.rbegin(); it != ids.rend(); ++it) visit(*it);
+    }
+
+    static bool allDigits(string_view text) {
+        return !text.empty() && all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; });
+    }
+
+public:
+    void clear() {
+        nodes.clear();
+        childSlots.clear();
+        sameKey.clear();
+    }
+
+    // phone must stay valid as long as the trie, like the book's own fields
+    void insert(uint32_t id, string_view phone) {
+        if (!allDigits(phone)) return;
+        if (sameKey.size() <= id) sameKey.resize(id + 1, NONE);
+        if (nodes.empty()) addNode(phone.data(), 0);
+        uint32_t at = 0;
+        size_t pos = 0;
+        while (pos < phone.size()) {
+            uint32_t next = child(at, phone[pos]);
+            if (next == NONE) {
+                next = addNode(phone.data() + pos, phone.size() - pos);
+                setChild(at, phone[pos], next);
+                at = next;
+                break;
+            }
+            uint32_t common = 0, limit = min<size_t>(nodes[next].length, phone.size() - pos);
+            while (common < limit && nodes[next].label[common] == phone[pos + common]) ++common;
+            if (common < nodes[next].length) { // Split the edge where the phones part ways
+                uint32_t middle = addNode(nodes[next].label, common);
+                setChild(at, phone[pos], middle);
+                nodes[next].label += common;
+                nodes[next].length -= common;
+                setChild(middle, nodes[next].label[0], next);
+                next = middle;
+            }
+            at = next;
+            pos += common;
+        }
+        sameKey[id] = nodes[at].id;
+        nodes[at].id = id;
+    }
+
+    // Visit (length, id) for every id whose phone is a prefix of number (number itself included),
+    // shortest phones first
+    template <typename Visit>
+    void forEachPrefixOf(string_view number, Visit visit) const {
+        if (nodes.empty() || !allDigits(number)) return;
+        uint32_t at = 0;
+        size_t pos = 0;
+        while (pos < number.size()) {
+            at = child(at, number[pos]);
+            if (at == NONE || nodes[at].length > number.size() - pos ||
+                number.compare(pos, nodes[at].length, nodes[at].label, nodes[at].length) != 0) return;
+            pos += nodes[at].length;
+            visitIds(at, [&](uint32_t id) { visit(pos, id); });
+        }
+    }
+
+    // Visit the ids whose phone starts with prefix, in phone order (book order for equal phones)
+    template <typename Visit>
+    void forEachWithPrefix(string_view prefix, Visit visit) const {
+        if (nodes.empty() || !allDigits(prefix)) return;
+        uint32_t at = 0;
+        size_t pos = 0;
+        while (pos < prefix.size()) {
+            at = child(at, prefix[pos]);
+            if (at == NONE) return;
+            size_t length = min<size_t>(nodes[at].length, prefix.size() - pos);
+            if (prefix.compare(pos, length, nodes[at].label, length) != 0) return;
+            pos += length;
+        }
+        vector<uint32_t> pending{ at };
+        while (!pending.empty()) {
+            uint32_t node = pending.back();
+            pending.pop_back();
+            visitIds(node, visit);
+            if (nodes[node].children == NONE) continue;
+            for (int digit = 9; digit >= 0; --digit) { // Pushed in reverse so '0' comes out first
+                uint32_t next = childSlots[nodes[node].children + digit];
+                if (next != NONE) pending.push_back(next);
+            }
+        }
+    }
+
+    size_t nodeCount() const { return nodes.size(); }
+
+    // Image for the startup cache: per node its label length, id and first child slot, then the
+    // labels back to back, the child slots and the same-phone chains
+    template <typename Emit>
+    void save(Emit& emit) const {
+        vector<uint32_t> lengths, ids, firstChildren;
+        string labels;
+        for (const Node& node : nodes) {
+            lengths.push_back(node.length);
+            ids.push_back(node.id);
+            firstChildren.push_back(node.children);
+            labels.append(node.label, node.length);
+        }
+        emitArray(emit, lengths);
+        emitArray(emit, ids);
+        emitArray(emit, firstChildren);
+        emitNumber(emit, labels.size());
+        emit(labels);
+        emitArray(emit, childSlots);
+        emitArray(emit, sameKey);
+    }
+
+    bool load(ImageReader& in, size_t slotCount) {
+        ImageArray<uint32_t> lengths, ids, firstChildren;
+        if (!in.array(lengths) || !in.array(ids) || !in.array(firstChildren)) return false;
+        string_view labels = in.bytes(in.number());
+        if (!in.array(childSlots) || !in.array(sameKey) || sameKey.size() > slotCount) return false;
+        if (ids.size() != lengths.size() || firstChildren.size() != lengths.size()) return false;
+        string_view stored = contactArena.store(labels); // Labels used to view the book's phones
+        nodes.clear();
+        nodes.reserve(lengths.size());
+        size_t at = 0;
+        for (size_t i = 0; i < lengths.size(); ++i) {
+            if (lengths[i] > labels.size() - at || (ids[i] != NONE && ids[i] >= sameKey.size())) return false;
+            if (firstChildren[i] != NONE && (firstChildren[i] > childSlots.size() || childSlots.size() - firstChildren[i] < 10)) return false;
+            nodes.push_back(Node{ stored.data() + at, lengths[i], ids[i], firstChildren[i] });
+            at += lengths[i];
+        }
+        for (uint32_t slot : childSlots) {
+            if (slot != NONE && slot >= nodes.size()) return false;
+        }
+        return at == labels.size();
+    }
+};
+
+// Worker threads for data-parallel loops. parallelFor() deals the index range out as one
+// contiguous block per queue; each thread takes indices from the back of its own queue and, once
+// that is empty, steals from the front of the others, so one slow block does not hold up the
+// loop. The calling thread works along and returns once every index has run.
+class WorkStealingPool {
+private:
+    struct alignas(64) Queue {
+        mutex lock;
+        deque<size_t> items;
+    };
+    vector<unique_ptr<Queue>> queues; // One per worker, the last one for the caller
+    vector<thread> workers;
+    mutex jobMutex;                   // One parallelFor at a time
+    mutex sleepMutex;
+    condition_variable wake, finished;
+    const function<void(size_t)>* body = nullptr;
+    uint64_t generation = 0;          // Bumped per job so sleeping workers notice it
+    atomic<size_t> remaining{0};
+    bool stopping = false;
+
+    bool take(size_t self, size_t& item) {
+        for (size_t k = 0; k < queues.size(); ++k) {
+            Queue& queue = *queues[(self + k) % queues.size()];
+            lock_guard<mutex> lock(queue.lock);
+            if (queue.items.empty()) continue;
+            if (k == 0) { item = queue.items.back(); queue.items.pop_back(); }
+            else { item = queue.items.front(); queue.items.pop_front(); } // Steal the far end
+            return true;
+        }
+        return false;
+    }
+
+    void work(size_t self) {
+        size_t item;
+        while (take(self, item)) {
+            (*body)(item);
+            if (remaining.fetch_sub(1) == 1) {
+                lock_guard<mutex> lock(sleepMutex);
+                finished.notify_all();
+            }
+        }
+    }
+
+    // Hand out one job; the caller holds jobMutex
+    template <typename Run>
+    void runJob(size_t count, Run& run) {
+        if (count == 0) return;
+        function<void(size_t)> call = run;
+        body = &call;
+        remaining = count;
+        size_t n = queues.size();
+        for (size_t q = 0; q < n; ++q) {
+            lock_guard<mutex> lock(queues[q]->lock);
+            for (size_t i = q * count / n; i < (q + 1) * count / n; ++i) queues[q]->items.push_back(i);
+        }
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            ++generation;
+        }
+        wake.notify_all();
+        work(n - 1);
+        unique_lock<mutex> lock(sleepMutex);
+        finished.wait(lock, [this] { return remaining.load() == 0; });
+    }
+
+public:
+    // threads counts the caller, so threads - 1 workers are started
+    explicit WorkStealingPool(size_t threads) {
+        threads = max<size_t>(1, threads);
+        for (size_t i = 0; i < threads; ++i) queues.push_back(make_unique<Queue>());
+        for (size_t self = 0; self + 1 < threads; ++self) {
+            workers.emplace_back([this, self] {
+                uint64_t seen = 0;
+                while (true) {
+                    {
+                        unique_lock<mutex> lock(sleepMutex);
+                        wake.wait(lock, [&] { return stopping || generation != seen; });
+                        if (stopping) return;
+                        seen = generation;
+                    }
+                    work(self);
+                }
+            });
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    size_t size() const { return queues.size(); }
+
+    // Run run(i) for every i in [0, count) across the pool
+    template <typename Run>
+    void parallelFor(size_t count, Run run) {
+        lock_guard<mutex> job(jobMutex);
+        runJob(count, run);
+    }
+
+    // Like parallelFor, but run everything on the calling thread instead of waiting while another
+    // thread's job has the pool
+    template <typename Run>
+    void parallelForOrInline(size_t count, Run run) {
+        unique_lock<mutex> job(jobMutex, try_to_lock);
+        if (job.owns_lock()) runJob(count, run);
+        else for (size_t i = 0; i < count; ++i) run(i);
+    }
+};
+
+// The contacts plus the indexes kept in sync with them. A contact's id is its slot; deleting
+// leaves a tombstone so ids stay stable, and tombstones are purged in bulk once they dominate.
+class ContactBook {
+private:
+    vector<Contact> slots;
+    vector<bool> live;
+    size_t liveCount = 0;
+    FieldIndex byName, byPhone, byEmail;
+    mutable TrigramIndex trigrams;      // Built on the first substring search, then kept up to date
+    mutable bool trigramsBuilt = false;
+    mutable NameIndex byNameOrder;      // Built on the first sort or prefix search, then kept up to date
+    mutable bool nameOrderBuilt = false;
+    mutable BkTree fuzzyNames;          // Built on the first fuzzy search, then kept up to date
+    mutable bool fuzzyNamesBuilt = false;
+    mutable PhoneTrie phones;           // Built on the first phone lookup, then kept up to date
+    mutable bool phonesBuilt = false;
+    mutable vector<StringArena::Pin> arenaPins; // Arena generations the contacts and index keys view
+
+    // Pin the arena generation that new contacts and index keys are stored in
+    void pinArena() const {
+        StringArena::Pin pin = contactArena.pin();
+        if (arenaPins.empty() || arenaPins.back() != pin) arenaPins.push_back(move(pin));
+    }
+
+    void ensureNameOrder() const {
+        if (nameOrderBuilt) return;
+        byNameOrder.build(slots);
+        nameOrderBuilt = true;
+    }
+
+    void ensureFuzzyNames() const {
+        if (fuzzyNamesBuilt) return;
+        pinArena(); // The tree stores folded keys
+        for (uint32_t id = 0; id < slots.size(); ++id) fuzzyNames.insert(id, slots[id].getName());
+        fuzzyNamesBuilt = true;
+    }
+
+    void ensurePhones() const {
+        if (phonesBuilt) return;
+        pinArena(); // The trie stores its labels
+        for (uint32_t id = 0; id < slots.size(); ++id) phones.insert(id, slots[id].getPhone());
+        phonesBuilt = true;
+    }
+
+    void ensureTrigrams() const {
+        if (trigramsBuilt) return;
+        for (uint32_t id = 0; id < slots.size(); ++id) trigrams.insert(id, slots[id]);
+        trigramsBuilt = true;
+    }
+
+    static bool contains(const Contact& contact, string_view query) {
+        return findIn(contact.getName(), query) != NOT_FOUND ||
+               findIn(contact.getPhone(), query) != NOT_FOUND ||
+               findIn(contact.getEmail(), query) != NOT_FOUND;
+    }
+
+    void index(uint32_t id) {
+        byName.insert(slots[id].getName(), id);
+        byPhone.insert(slots[id].getPhone(), id);
+        byEmail.insert(slots[id].getEmail(), id);
+    }
+
+    void kill(uint32_t id) {
+        live[id] = false;
+        --liveCount;
+        byName.erase(slots[id].getName());
+        byPhone.erase(slots[id].getPhone());
+        byEmail.erase(slots[id].getEmail());
+    }
+
+    bool fail() {
+        assign({});
+        return false;
+    }
+
+    // Drop tombstones and re-index the surviving contacts, keeping their order. Their fields are
+    // copied into a new arena generation, so the old one, with the deleted contacts' bytes, is
+    // freed once no other book or queued snapshot pins it.
+    void rebuild() {
+        contactArena.renew();
+        vector<Contact> kept;
+        kept.reserve(liveCount);
+        forEach([&kept](const Contact& contact) { kept.emplace_back(contact.getName(), contact.getPhone(), contact.getEmail()); });
+        arenaPins.clear();
+        assign(move(kept));
+    }
+
+public:
+    ContactBook() = default;
+    explicit ContactBook(vector<Contact>&& contacts) { assign(move(contacts)); }
+
+    void assign(vector<Contact>&& contacts) {
+        pinArena();
+        slots = move(contacts);
+        live.assign(slots.size(), true);
+        liveCount = slots.size();
+        byName.clear(slots.size());
+        byPhone.clear(slots.size());
+        byEmail.clear(slots.size());
+        for (uint32_t id = 0; id < slots.size(); ++id) index(id);
+        trigrams.clear();
+        trigramsBuilt = false;
+        byNameOrder.clear();
+        nameOrderBuilt = false;
+        fuzzyNames.clear();
+        fuzzyNamesBuilt = false;
+        phones.clear();
+        phonesBuilt = false;
+    }
+
+    size_t size() const { return liveCount; }
+    bool empty() const { return liveCount == 0; }
+
+    // Build the lazily created indexes now. Afterwards const calls no longer modify the book, so
+    // any number of threads may read it as long as nobody writes.
+    void buildIndexes() const {
+        ensureTrigrams();
+        ensureNameOrder();
+        ensureFuzzyNames();
+        ensurePhones();
+    }
+
+    // Visit live contacts in book order
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        for (size_t id = 0; id < slots.size(); ++id) {
+            if (live[id]) visit(slots[id]);
+        }
+    }
+
+    const Contact& add(const Contact& contact) {
+        pinArena();
+        slots.push_back(contact);
+        live.push_back(true);
+        ++liveCount;
+        index(slots.size() - 1);
+        if (trigramsBuilt) trigrams.insert(slots.size() - 1, slots.back());
+        if (nameOrderBuilt) byNameOrder.insert(slots.size() - 1, slots);
+        if (fuzzyNamesBuilt) fuzzyNames.insert(slots.size() - 1, slots.back().getName());
+        if (phonesBuilt) phones.insert(slots.size() - 1, slots.back().getPhone());
+        return slots.back();
+    }
+
+    // Visit up to count live contacts starting at the first-th one, in book order. Without
+    // tombstones the position is the slot itself; otherwise the live flags before it are counted.
+    template <typename Visit>
+    void forEachInRange(size_t first, size_t count, Visit visit) const {
+        size_t id = 0, skipped = 0;
+        if (liveCount == slots.size()) id = skipped = first;
+        for (; id < slots.size() && count > 0; ++id) {
+            if (!live[id]) continue;
+            if (skipped < first) { ++skipped; continue; }
+            visit(slots[id]);
+            --count;
+        }
+    }
+
+    uint32_t countName(string_view name) const { return byName.count(name); }
+
+    // Visit live contacts with query as a substring of any field, in book order
+    template <typename Visit>
+    void search(string_view query, Visit visit) const {
+        if (query.size() < TrigramIndex::MIN_QUERY) { // Too short to have a trigram: plain scan
+            forEach([&](const Contact& contact) { if (contains(contact, query)) visit(contact); });
+            return;
+        }
+        ensureTrigrams();
+        thread_local vector<uint32_t> matches;
+        trigrams.candidates(query, matches);
+        for (uint32_t id : matches) {
+            if (live[id] && contains(slots[id], query)) visit(slots[id]);
+        }
+    }
+
+    // Visit live contacts in name order (ties in book order)
+    template <typename Visit>
+    void forEachByName(Visit visit) const {
+        ensureNameOrder();
+        byNameOrder.forEach([&](uint32_t id) { if (live[id]) visit(slots[id]); });
+    }
+
+    // Substring search that checks every contact, split into shards of about SHARD_BYTES that run
+    // on pool. Each shard collects its own matches, so the result is deterministic: book order, or
+    // with byName a merge of the shards' name-sorted matches (ties in book order).
+    template <typename Visit>
+    void parallelScan(string_view query, WorkStealingPool& pool, bool byName, Visit visit) const {
+        static constexpr size_t SHARD_BYTES = 256 * 1024; // Keep a shard's rows and fields in L2
+        size_t sampleBytes = 0, sampled = 0;
+        for (size_t id = 0; id < slots.size(); id += max<size_t>(1, slots.size() / 64), ++sampled) {
+            sampleBytes += sizeof(Contact) + slots[id].getName().size() + slots[id].getPhone().size() + slots[id].getEmail().size();
+        }
+        size_t shardSize = max<size_t>(256, SHARD_BYTES / max<size_t>(1, sampleBytes / max<size_t>(1, sampled)));
+        size_t shards = (slots.size() + shardSize - 1) / shardSize;
+
+        vector<vector<uint32_t>> matches(shards);
+        auto byNameThenId = [this](uint32_t a, uint32_t b) {
+            int order = slots[a].getName().compare(slots[b].getName());
+            return order != 0 ? order < 0 : a < b;
+        };
+        pool.parallelForOrInline(shards, [&](size_t shard) { // Server threads may search at the same time
+            vector<uint32_t>& found = matches[shard];
+            size_t end = min(slots.size(), (shard + 1) * shardSize);
+            for (size_t id = shard * shardSize; id < end; ++id) {
+                if (live[id] && contains(slots[id], query)) found.push_back(id);
+            }
+            if (byName) sort(found.begin(), found.end(), byNameThenId);
+        });
+
+        if (!byName) {
+            for (const auto& found : matches) {
+                for (uint32_t id : found) visit(slots[id]);
+            }
+            return;
+        }
+        // k-way merge; the heap holds each shard's next match
+        using Cursor = pair<size_t, size_t>; // shard, position
+        auto later = [&](const Cursor& a, const Cursor& b) { return byNameThenId(matches[b.first][b.second], matches[a.first][a.second]); };
+        vector<Cursor> heap;
+        for (size_t shard = 0; shard < shards; ++shard) {
+            if (!matches[shard].empty()) heap.emplace_back(shard, 0);
+        }
+        make_heap(heap.begin(), heap.end(), later);
+        while (!heap.empty()) {
+            pop_heap(heap.begin(), heap.end(), later);
+            Cursor& next = heap.back();
+            visit(slots[matches[next.first][next.second]]);
+            if (++next.second < matches[next.first].size()) push_heap(heap.begin(), heap.end(), later);
+            else heap.pop_back();
+        }
+    }
+
+    // Visit live contacts whose name is within k edits of query (ignoring case), nearest first, then
+    // by name and book order; returns how many distinct names had their distance computed
+    template <typename Visit>
+    size_t searchFuzzy(string_view query, uint32_t k, Visit visit) const {
+        ensureFuzzyNames();
+        vector<pair<uint32_t, uint32_t>> found; // distance, id
+        size_t computed = fuzzyNames.search(query, k, [&](uint32_t d, uint32_t id) { if (live[id]) found.emplace_back(d, id); });
+        sort(found.begin(), found.end(), [this](const pair<uint32_t, uint32_t>& a, const pair<uint32_t, uint32_t>& b) {
+            if (a.first != b.first) return a.first < b.first;
+            int order = slots[a.second].getName().compare(slots[b.second].getName());
+            return order != 0 ? order < 0 : a.second < b.second;
+        });
+        for (const auto& match : found) visit(match.first, slots[match.second]);
+        return computed;
+    }
+
+    size_t fuzzyNameCount() const { return fuzzyNames.size(); }
+
+    // Caller-ID lookup: visit, in book order, the live contacts whose phone is the longest one that
+    // number starts with (number itself when some contact has it); returns that phone's length,
+    // 0 when none matches
+    template <typename Visit>
+    size_t lookupPhone(string_view number, Visit visit) const {
+        ensurePhones();
+        size_t longest = 0;
+        vector<uint32_t> ids;
+        phones.forEachPrefixOf(number, [&](size_t length, uint32_t id) {
+            if (!live[id]) return;
+            if (length > longest) {
+                longest = length;
+                ids.clear();
+            }
+            ids.push_back(id);
+        });
+        for (uint32_t id : ids) visit(slots[id]);
+        return longest;
+    }
+
+    // Visit live contacts whose phone starts with prefix, in phone order (ties in book order)
+    template <typename Visit>
+    void searchPhonePrefix(string_view prefix, Visit visit) const {
+        ensurePhones();
+        phones.forEachWithPrefix(prefix, [&](uint32_t id) { if (live[id]) visit(slots[id]); });
+    }
+
+    // Visit live contacts whose name starts with prefix, in name order
+    template <typename Visit>
+    void searchPrefix(string_view prefix, Visit visit) const {
+        ensureNameOrder();
+        byNameOrder.forEachWithPrefix(prefix, slots, [&](uint32_t id) { if (live[id]) visit(slots[id]); });
+    }
+
+    // Delete every contact whose name, phone or email equals query
+    bool removeMatching(string_view query) {
+        size_t before = liveCount;
+        auto remove = [this](uint32_t id) { if (live[id]) kill(id); };
+        byName.forEach(query, remove);
+        byPhone.forEach(query, remove);
+        byEmail.forEach(query, remove);
+        if (slots.size() > 1024 && liveCount < slots.size() / 2) rebuild();
+        return liveCount != before;
+    }
+
+    // Order contacts alphabetically by name. The name index already holds that order, so this
+    // is one pass over it; the rebuilt index then finds the book sorted and is also one pass.
+    void sortByName() {
+        vector<Contact> sorted;
+        sorted.reserve(liveCount);
+        forEachByName([&sorted](const Contact& contact) { sorted.push_back(contact); });
+        assign(move(sorted));
+    }
+
+    // What must be held for copies of the contacts to outlive changes to the book
+    vector<StringArena::Pin> pins() const { return arenaPins; }
+
+    // Copy of the live contacts in book order, e.g. for writing a snapshot
+    vector<Contact> snapshot() const {
+        vector<Contact> contacts;
+        contacts.reserve(liveCount);
+        forEach([&contacts](const Contact& contact) { contacts.push_back(contact); });
+        return contacts;
+    }
+
+    // Which of the lazily built indexes exist, as INDEX_* bits
+    static constexpr uint64_t INDEX_TRIGRAMS = 1, INDEX_NAME_ORDER = 2, INDEX_FUZZY_NAMES = 4, INDEX_PHONES = 8;
+    uint64_t builtIndexes() const {
+        return (trigramsBuilt ? INDEX_TRIGRAMS : 0) | (nameOrderBuilt ? INDEX_NAME_ORDER : 0) |
+               (fuzzyNamesBuilt ? INDEX_FUZZY_NAMES : 0) | (phonesBuilt ? INDEX_PHONES : 0);
+    }
+
+    // Image of the book for the startup cache, tombstones included so ids stay valid: the field
+    // bytes, their lengths, the deleted ids, the hash indexes, then every lazy index built so far
+    template <typename Emit>
+    void save(Emit& emit) const {
+        vector<uint32_t> lengths(slots.size() * 3);
+        uint64_t fieldBytes = 0;
+        for (size_t id = 0; id < slots.size(); ++id) {
+            lengths[3 * id] = slots[id].getName().size();
+            lengths[3 * id + 1] = slots[id].getPhone().size();
+            lengths[3 * id + 2] = slots[id].getEmail().size();
+            fieldBytes += lengths[3 * id] + lengths[3 * id + 1] + lengths[3 * id + 2];
+        }
+        emitNumber(emit, fieldBytes);
+        string chunk; // Fields are gathered into large pieces, a few bytes each would be slow to emit
+        for (const Contact& contact : slots) {
+            chunk.append(contact.getName()).append(contact.getPhone()).append(contact.getEmail());
+            if (chunk.size() >= (1 << 20)) {
+                emit(chunk);
+                chunk.clear();
+            }
+        }
+        emit(chunk);
+        emitArray(emit, lengths);
+        vector<uint32_t> deleted;
+        for (uint32_t id = 0; id < slots.size(); ++id) {
+            if (!live[id]) deleted.push_back(id);
+        }
+        emitArray(emit, deleted);
+        vector<uint64_t> starts(slots.size()); // Offset of each contact's fields
+        for (size_t id = 1; id < slots.size(); ++id) {
+            starts[id] = starts[id - 1] + lengths[3 * id - 3] + lengths[3 * id - 2] + lengths[3 * id - 1];
+        }
+        byName.save(emit, [&](uint32_t id) { return starts[id]; });
+        byPhone.save(emit, [&](uint32_t id) { return starts[id] + lengths[3 * id]; });
+        byEmail.save(emit, [&](uint32_t id) { return starts[id] + lengths[3 * id] + lengths[3 * id + 1]; });
+        emitNumber(emit, builtIndexes());
+        if (trigramsBuilt) trigrams.save(emit);
+        if (nameOrderBuilt) byNameOrder.save(emit);
+        if (fuzzyNamesBuilt) fuzzyNames.save(emit);
+        if (phonesBuilt) phones.save(emit);
+    }
+
+    // Restore an image written by save(). The contacts view its field bytes, which must outlive the
+    // book; everything else is copied. On failure the book is left empty.
+    bool load(ImageReader& in) {
+        assign({});
+        ImageArray<uint32_t> lengths, deleted;
+        string_view fields = in.bytes(in.number(), true);
+        if (!in.array(lengths) || lengths.size() % 3 != 0 || !in.array(deleted)) return false;
+
+        vector<Contact> contacts;
+        contacts.reserve(lengths.size() / 3);
+        size_t at = 0;
+        for (size_t i = 0; i < lengths.size(); i += 3) {
+            uint64_t name = lengths[i], phone = lengths[i + 1], email = lengths[i + 2];
+            if (name + phone + email > fields.size() - at) return false;
+            contacts.push_back(Contact::view(fields.substr(at, name), fields.substr(at + name, phone), fields.substr(at + name + phone, email)));
+            at += name + phone + email;
+        }
+        if (at != fields.size()) return false;
+        slots = move(contacts);
+        live.assign(slots.size(), true);
+        liveCount = slots.size();
+        for (size_t i = 0; i < deleted.size(); ++i) {
+            uint32_t id = deleted[i];
+            if (id >= slots.size() || !live[id]) return fail();
+            live[id] = false;
+            --liveCount;
+        }
+        in.consumed();
+
+        bool ok = byName.load(in, slots.size(), fields) && byPhone.load(in, slots.size(), fields) && byEmail.load(in, slots.size(), fields);
+        in.consumed();
+        uint64_t built = ok ? in.number() : 0;
+        if (ok && (built & INDEX_TRIGRAMS)) ok = trigramsBuilt = trigrams.load(in);
+        in.consumed();
+        if (ok && (built & INDEX_NAME_ORDER)) ok = nameOrderBuilt = byNameOrder.load(in, slots.size());
+        in.consumed();
+        if (ok && (built & INDEX_FUZZY_NAMES)) ok = fuzzyNamesBuilt = fuzzyNames.load(in, slots.size());
+        in.consumed();
+        if (ok && (built & INDEX_PHONES)) ok = phonesBuilt = phones.load(in, slots.size());
+        if (!ok || !in.atEnd()) return fail();
+        return true;
+    }
+};
+
+// A contact book shared between threads, using left-right concurrency control: the caller's book
+// and a replica are kept identical, and readers use the one readIndex points at without ever
+// blocking or taking a lock, they only bump a counter in their own slot. One writer at a time
+// changes the other copy, publishes it by flipping readIndex, waits for the readers still on the
+// old copy to leave, then replays the same change there. A read therefore always sees one complete
+// version, reads never wait for writes, and writes never copy the book.
+class ConcurrentBook {
+private:
+    static constexpr size_t READER_SLOTS = 64;
+    struct alignas(64) ReaderSlot {     // One cache line per slot so readers do not share counters
+        atomic<uint32_t> readers[2] = { {0}, {0} };
+    };
+    ContactBook replica;
+    ContactBook* books[2];
+    atomic<int> readIndex{0};
+    mutable ReaderSlot slots[READER_SLOTS];
+    mutex writerMutex;
+
+    static size_t slotIndex() {
+        static atomic<size_t> nextSlot{0};
+        thread_local size_t slot = nextSlot++ % READER_SLOTS;
+        return slot;
+    }
+
+    void waitForReaders(int side) const {
+        for (const auto& slot : slots) {
+            while (slot.readers[side].load() != 0) this_thread::yield();
+        }
+    }
+
+public:
+    // Share book, which must from then on only be changed through write(). The replica stores its
+    // own copy of every field, so it never views arena bytes only book pins.
+    explicit ConcurrentBook(ContactBook& book) : books{ &book, &replica } {
+        vector<Contact> copies;
+        copies.reserve(book.size());
+        book.forEach([&copies](const Contact& contact) { copies.emplace_back(contact.getName(), contact.getPhone(), contact.getEmail()); });
+        replica.assign(move(copies));
+        book.buildIndexes();
+        replica.buildIndexes();
+    }
+
+    // Run read(const ContactBook&) against the current version; safe from any thread
+    template <typename Read>
+    auto read(Read read) const {
+        ReaderSlot& slot = slots[slotIndex()];
+        int side;
+        while (true) {
+            side = readIndex.load();
+            slot.readers[side].fetch_add(1);
+            if (readIndex.load() == side) break; // The writer cannot have missed this reader
+            slot.readers[side].fetch_sub(1);     // It flipped meanwhile; follow it
+        }
+        struct Leave {
+            atomic<uint32_t>& count;
+            ~Leave() { count.fetch_sub(1); }
+        } leave{ slot.readers[side] };
+        return read(static_cast<const ContactBook&>(*books[side]));
+    }
+
+    // Make a change and return change's result. change(ContactBook&) runs once, on the copy readers
+    // are not using; once that copy is published, replay(ContactBook&, result) must make the same
+    // change to the other one. Safe from any thread; writers take turns.
+    template <typename Change, typename Replay>
+    auto write(Change change, Replay replay) {
+        lock_guard<mutex> lock(writerMutex);
+        int side = readIndex.load();
+        auto result = change(*books[1 - side]);
+        books[1 - side]->buildIndexes(); // A tombstone purge or sort resets them
+        readIndex.store(1 - side);
+        waitForReaders(side);
+        replay(*books[side], result);
+        books[side]->buildIndexes();
+        return result;
+    }
+};
+
+// Columnar (structure-of-arrays) contact storage. Each field's characters are packed back to back
+// in one arena, and an offset array marks where each contact's value starts, so value i spans
+// [offsets[i], offsets[i + 1]). Scans walk three contiguous buffers instead of chasing a pointer
+// per field per contact.
+class ContactTable {
+private:
+    struct Column {
+        string chars;                        // Every value of the field, concatenated
+        vector<uint32_t> offsets = { 0 };    // One entry per contact plus the end offset
+
+        string_view at(size_t i) const { return string_view(chars).substr(offsets[i], offsets[i + 1] - offsets[i]); }
+        void push(string_view value) {
+            chars.append(value.data(), value.size());
+            offsets.push_back(chars.size());
+        }
+        void reserve(size_t count, size_t bytes) {
+            offsets.reserve(count + 1);
+            chars.reserve(bytes);
+        }
+        size_t memoryBytes() const { return chars.capacity() + offsets.capacity() * sizeof(uint32_t); }
+
+        // Mark every value containing query; a hit straddling two values is not a match
+        void markMatches(string_view query, vector<bool>& hits) const {
+            size_t pos = findIn(chars, query);
+            while (pos != NOT_FOUND) {
+                size_t id = upper_bound(offsets.begin(), offsets.end(), pos) - offsets.begin() - 1;
+                if (pos + query.size() <= offsets[id + 1]) {
+                    hits[id] = true;
+                    pos = offsets[id + 1]; // Continue with the next value
+                } else {
+                    ++pos;
+                }
+                if (pos >= chars.size()) break;
+                size_t next = findIn(string_view(chars).substr(pos), query);
+                pos = next == NOT_FOUND ? NOT_FOUND : pos + next;
+            }
+        }
+    };
+
+    Column names, phones, emails;
+    vector<bool> live;
+    size_t liveCount = 0;
+
+    void rebuild(const vector<uint32_t>& order) {
+        ContactTable table;
+        table.reserve(order.size(), names.chars.size(), phones.chars.size(), emails.chars.size());
+        for (uint32_t id : order) table.add(names.at(id), phones.at(id), emails.at(id));
+        *this = move(table);
+    }
+
+    vector<uint32_t> liveIds() const {
+        vector<uint32_t> ids;
+        ids.reserve(liveCount);
+        for (uint32_t id = 0; id < live.size(); ++id) {
+            if (live[id]) ids.push_back(id);
+        }
+        return ids;
+    }
+
+public:
+    size_t size() const { return liveCount; }
+
+    void reserve(size_t count, size_t nameBytes, size_t phoneBytes, size_t emailBytes) {
+        names.reserve(count, nameBytes);
+        phones.reserve(count, phoneBytes);
+        emails.reserve(count, emailBytes);
+        live.reserve(count);
+    }
+
+    void add(string_view name, string_view phone, string_view email) {
+        names.push(name);
+        phones.push(phone);
+        emails.push(email);
+        live.push_back(true);
+        ++liveCount;
+    }
+
+    // View of contact id; valid until the table is next modified
+    Contact at(size_t id) const { return Contact::view(names.at(id), phones.at(id), emails.at(id)); }
+
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        for (size_t id = 0; id < live.size(); ++id) {
+            if (live[id]) visit(at(id));
+        }
+    }
+
+    // Visit live contacts with query as a substring of any field, in table order
+    template <typename Visit>
+    void search(string_view query, Visit visit) const {
+        vector<bool> hits(live.size(), false);
+        names.markMatches(query, hits);
+        phones.markMatches(query, hits);
+        emails.markMatches(query, hits);
+        for (size_t id = 0; id < live.size(); ++id) {
+            if (hits[id] && live[id]) visit(at(id));
+        }
+    }
+
+    // Delete every contact whose name, phone or email equals query
+    bool removeMatching(string_view query) {
+        size_t before = liveCount;
+        for (size_t id = 0; id < live.size(); ++id) {
+            if (live[id] && (names.at(id) == query || phones.at(id) == query || emails.at(id) == query)) {
+                live[id] = false;
+                --liveCount;
+            }
+        }
+        if (live.size() > 1024 && liveCount < live.size() / 2) rebuild(liveIds());
+        return liveCount != before;
+    }
+
+    void sortByName() {
+        vector<uint32_t> order = liveIds();
+        stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return names.at(a) < names.at(b); });
+        rebuild(order);
+    }
+
+    size_t memoryBytes() const {
+        return names.memoryBytes() + phones.memoryBytes() + emails.memoryBytes() + live.capacity() / 8;
+    }
+};
+
+// Validation functions
+// Phone and email formats are recognised by DFAs whose transition tables are built at compile
+// time; each check is one pass over the input with a table lookup per byte. They accept exactly
+// the languages of the original patterns, which --check-validators re-checks against std::regex:
+//   phone: ^\d{8,15}$
+//   email: ^[a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,}$
+const char* const PHONE_PATTERN = R"(^\d{8,15}$)";
+const char* const EMAIL_PATTERN = R"(^[a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,}$)";
+
+template <size_t States>
+struct Dfa {
+    static constexpr uint8_t DEAD = States - 1;
+    array<array<uint8_t, 256>, States> next{};
+    array<bool, States> accepting{};
+
+    constexpr bool matches(string_view input) const {
+        uint8_t state = 0;
+        for (char c : input) {
+            state = next[state][static_cast<unsigned char>(c)];
+            if (state == DEAD) return false;
+        }
+        return accepting[state];
+    }
+};
+
+constexpr bool isAsciiAlpha(int c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+constexpr bool isAsciiDigit(int c) { return c >= '0' && c <= '9'; }
+
+// States 0..15 count digits seen; 8..15 accept; 16 is dead
+constexpr Dfa<17> makePhoneDfa() {
+    Dfa<17> dfa;
+    for (int state = 0; state < 17; ++state) {
+        for (int c = 0; c < 256; ++c) dfa.next[state][c] = (state < 15 && isAsciiDigit(c)) ? state + 1 : dfa.DEAD;
+        dfa.accepting[state] = state >= 8 && state <= 15;
+    }
+    return dfa;
+}
+
+// Local part, '@', then a domain whose last '.' follows at least one character and is followed
+// by two or more letters. Since the final label holds letters only, its dot is the last one.
+enum EmailState : uint8_t {
+    LOCAL_START, LOCAL,         // Before / inside [a-zA-Z0-9._%+-]+
+    DOMAIN_START, DOMAIN,       // Right after '@' / inside [a-zA-Z0-9.-]+ with no candidate final label
+    DOT, TLD_ONE, TLD,          // Candidate final dot, then one / two or more letters after it
+    EMAIL_DEAD
+};
+
+constexpr Dfa<8> makeEmailDfa() {
+    Dfa<8> dfa;
+    for (int c = 0; c < 256; ++c) {
+        bool alpha = isAsciiAlpha(c), digit = isAsciiDigit(c);
+        bool localChar = alpha || digit || c == '.' || c == '_' || c == '%' || c == '+' || c == '-';
+        bool domainChar = alpha || digit || c == '.' || c == '-';
+        for (int state = 0; state < 8; ++state) dfa.next[state][c] = EMAIL_DEAD;
+
+        if (localChar) dfa.next[LOCAL_START][c] = dfa.next[LOCAL][c] = LOCAL;
+        if (c == '@') dfa.next[LOCAL][c] = DOMAIN_START;
+        if (domainChar) {
+            dfa.next[DOMAIN_START][c] = DOMAIN; // A leading dot cannot be the final one
+            dfa.next[DOMAIN][c] = c == '.' ? DOT : DOMAIN;
+            for (uint8_t state : { DOT, TLD_ONE, TLD }) {
+                dfa.next[state][c] = c == '.' ? DOT : !alpha ? DOMAIN : state == DOT ? TLD_ONE : TLD;
+            }
+        }
+    }
+    dfa.accepting[TLD] = true;
+    return dfa;
+}
+
+constexpr Dfa<17> PHONE_DFA = makePhoneDfa();
+constexpr Dfa<8> EMAIL_DFA = makeEmailDfa();
+
+static_assert(PHONE_DFA.matches("12345678") && PHONE_DFA.matches("123456789012345"), "phone lengths 8-15");
+static_assert(!PHONE_DFA.matches("1234567") && !PHONE_DFA.matches("1234567890123456") && !PHONE_DFA.matches("1234567a"), "phone rejects");
+static_assert(EMAIL_DFA.matches("ram@example.com") && EMAIL_DFA.matches("a.b_c%d+e-f@x-y.z.org") && EMAIL_DFA.matches("a@..co"), "email accepts");
+static_assert(!EMAIL_DFA.matches("@example.com") && !EMAIL_DFA.matches("a@.com") && !EMAIL_DFA.matches("a@b.c") &&
+              !EMAIL_DFA.matches("a@b.c0m") && !EMAIL_DFA.matches("a@b@c.com") && !EMAIL_DFA.matches("a@bcom"), "email rejects");
+
+bool isValidPhone(string_view input) {
+    return input == "-" || PHONE_DFA.matches(input); // "-" stands for the default 0000000000
+}
+
+bool isValidEmail(string_view input) {
+    return input == "-" || EMAIL_DFA.matches(input); // Allow "-" or valid email format
+}
+
+bool isValidName(string_view input) {
+    if (input == "-" || input.empty()) return true; // Allow "-" or empty for default
+    if (input.length() < 1 || input.length() > 50) return false; // Length check
+    return scan.allNameChars(input.data(), input.size());
+}
+
+// Field detection
+bool isPhone(string_view input) { return isValidPhone(input); }
+bool isEmail(string_view input) { return isValidEmail(input) && input.find('@') != string_view::npos; }
+bool isName(string_view input) { return isValidName(input) && !isPhone(input) && !isEmail(input); }
+
+// Leading decimal number of text (0 if there is none), like atoi without needing a C string
+int parseInt(string_view text) {
+    int value = 0;
+    from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+// Whether text is one or more ASCII digits; unlike ::isdigit it takes any byte, including non-ASCII
+bool allDigits(string_view text) {
+    return !text.empty() && all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// Strip phone punctuation such as "+1 (555) 010-9999" down to the digits; text with other
+// characters is returned unchanged
+string phoneDigits(string_view input) {
+    string digits;
+    for (char c : input) {
+        if (c >= '0' && c <= '9') digits += c;
+        else if (c != ' ' && c != '-' && c != '(' && c != ')' && c != '.' && c != '+') return string(input);
+    }
+    return digits;
+}
+
+// Buffered output straight to a file descriptor: bytes collect in a 1 MiB buffer that is
+// handed to the kernel in one write() when full, so streaming a large book costs few syscalls
+// and constant memory
+class FileWriter {
+private:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+    string buffer;
+    bool failed = false;
+#ifndef _WIN32
+    int fd = -1;
+#else
+    FILE* file = nullptr;
+#endif
+
+    void drain() {
+        size_t done = 0;
+#ifndef _WIN32
+        while (done < buffer.size() && !failed) {
+            ssize_t written = ::write(fd, buffer.data() + done, buffer.size() - done);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) failed = true;
+            else done += written;
+        }
+#else
+        if (fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) failed = true;
+#endif
+        buffer.clear();
+    }
+
+public:
+    FileWriter() = default;
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+    ~FileWriter() { close(); }
+
+    // Create or truncate path, or with append set add to its end
+    bool open(const string& path, bool append = false) {
+        buffer.reserve(BUFFER_SIZE);
+        failed = false;
+#ifndef _WIN32
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644);
+        return fd >= 0;
+#else
+        file = fopen(path.c_str(), append ? "ab" : "wb");
+        return file != nullptr;
+#endif
+    }
+
+    void append(string_view bytes) {
+        if (buffer.size() + bytes.size() > BUFFER_SIZE) drain();
+        if (bytes.size() >= BUFFER_SIZE) { // Too big to buffer: write it through
+            buffer.assign(bytes.data(), bytes.size());
+            drain();
+        } else {
+            buffer.append(bytes.data(), bytes.size());
+        }
+    }
+
+    // Hand everything buffered to the operating system; false if any write failed
+    bool flush() {
+        drain();
+#ifdef _WIN32
+        if (file && fflush(file) != 0) failed = true;
+#endif
+        return !failed;
+    }
+
+    // Flush, then wait until the operating system has the file on disk
+    bool sync() {
+        flush();
+#ifndef _WIN32
+        if (fd >= 0 && fsync(fd) != 0) failed = true;
+#else
+        if (file && _commit(_fileno(file)) != 0) failed = true;
+#endif
+        return !failed;
+    }
+
+    // Flush and close; false if any write failed
+    bool close() {
+#ifndef _WIN32
+        if (fd < 0) return !failed;
+        drain();
+        if (::close(fd) != 0) failed = true;
+        fd = -1;
+#else
+        if (!file) return !failed;
+        drain();
+        if (fclose(file) != 0) failed = true;
+        file = nullptr;
+#endif
+        return !failed;
+    }
+};
+
+// Contact store location: phonebook.db next to the source file
+string storePath(const string& fileName) {
+    string source = PHONEBOOK_SOURCE;
+    size_t slash = source.find_last_of("/\\");
+    return (slash == string::npos ? string() : source.substr(0, slash + 1)) + fileName;
+}
+const string STORE_FILE = storePath("phonebook.db");
+
+// Make a rename into path's directory survive a crash: POSIX only records it on disk once the
+// directory itself is synced (Windows needs nothing extra)
+void syncDirectory(const string& path) {
+#ifndef _WIN32
+    size_t slash = path.find_last_of('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(directory.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    ::close(fd);
+#else
+    (void)path;
+#endif
+}
+
+// Binary store layout (all integers little-endian):
+//   header: "PBDB" | u32 version | u64 record count | u64 last LSN  (24 bytes, 16 in version 1)
+//   record: u32 name length | u32 phone length | u32 email length   (12 bytes)
+//           followed by the name, phone and email bytes
+// The last LSN is the newest write-ahead log record already folded into the snapshot.
+// Version 3 keeps the same header but stores compressed blocks instead (see BlockStore).
+const char STORE_MAGIC[4] = { 'P', 'B', 'D', 'B' };
+const uint32_t STORE_VERSION = 2;
+const uint32_t STORE_VERSION_BLOCKS = 3;
+const size_t STORE_HEADER_SIZE = 24;
+const size_t STORE_HEADER_SIZE_V1 = 16;
+const size_t RECORD_HEADER_SIZE = 12;
+
+enum class StoreStatus { Ok, Missing, Corrupt };
+
+// Snapshot layout written by writeStore. --store-format picks one; otherwise the format the store
+// already has is kept.
+enum class StoreFormat { Plain, Blocks };
+StoreFormat storeFormat = StoreFormat::Plain;
+bool storeFormatChosen = false;
+
+void putU32(string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out += static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+void putU64(string& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out += static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+uint32_t getU32(const char* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; --i) v = (v << 8) | static_cast<unsigned char>(p[i]);
+    return v;
+}
+uint64_t getU64(const char* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | static_cast<unsigned char>(p[i]);
+    return v;
+}
+
+// LEB128 varint: 7 bits per byte, low bits first
+void putVarint(string& out, uint64_t v) {
+    for (; v >= 0x80; v >>= 7) out += static_cast<char>(v | 0x80);
+    out += static_cast<char>(v);
+}
+// Read the varint at data[pos], advancing pos; false if it runs past the end
+bool getVarint(string_view data, size_t& pos, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; pos < data.size() && shift < 64; shift += 7) {
+        unsigned char byte = data[pos++];
+        v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Append one length-prefixed contact record
+void encodeContact(string& out, const Contact& contact) {
+    string_view name = contact.getName(), phone = contact.getPhone(), email = contact.getEmail();
+    putU32(out, name.size());
+    putU32(out, phone.size());
+    putU32(out, email.size());
+    out += name;
+    out += phone;
+    out += email;
+}
+
+// Decode the contact record at data[pos] into views of data, advancing pos; false if it is truncated
+bool decodeContact(string_view data, size_t& pos, string_view fields[3]) {
+    if (data.size() - pos < RECORD_HEADER_SIZE) return false;
+    size_t nameLen = getU32(data.data() + pos);
+    size_t phoneLen = getU32(data.data() + pos + 4);
+    size_t emailLen = getU32(data.data() + pos + 8);
+    pos += RECORD_HEADER_SIZE;
+    if (data.size() - pos < nameLen + phoneLen + emailLen) return false;
+    fields[0] = data.substr(pos, nameLen);
+    fields[1] = data.substr(pos + nameLen, phoneLen);
+    fields[2] = data.substr(pos + nameLen + phoneLen, emailLen);
+    pos += nameLen + phoneLen + emailLen;
+    return true;
+}
+
+uint32_t fnv1a(const char* data, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    return hash;
+}
+
+// 64-bit checksum of bytes that may arrive in pieces. Four independent lanes each mix in eight
+// bytes per step, so it keeps up with reading large files where byte-at-a-time FNV-1a would not.
+// Words are read in native byte order: the value is only compared on the machine that made it.
+class StreamChecksum {
+private:
+    static constexpr size_t BLOCK = 32;
+    uint64_t lanes[4] = { 0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0x27D4EB2F165667C5ULL };
+    char partial[BLOCK];  // Start of a block still being filled
+    size_t partialBytes = 0;
+    uint64_t total = 0;
+
+    void mix(const char* block) {
+        for (int i = 0; i < 4; ++i) {
+            uint64_t word;
+            memcpy(&word, block + 8 * i, sizeof(word));
+            lanes[i] = (lanes[i] ^ word) * 0xFF51AFD7ED558CCDULL;
+            lanes[i] ^= lanes[i] >> 29;
+        }
+    }
+
+public:
+    void update(const char* data, size_t length) {
+        total += length;
+        if (partialBytes > 0) {
+            size_t take = min(length, BLOCK - partialBytes);
+            memcpy(partial + partialBytes, data, take);
+            partialBytes += take;
+            data += take;
+            length -= take;
+            if (partialBytes < BLOCK) return;
+            mix(partial);
+            partialBytes = 0;
+        }
+        for (; length >= BLOCK; data += BLOCK, length -= BLOCK) mix(data);
+        memcpy(partial, data, length);
+        partialBytes = length;
+    }
+
+    uint64_t value() const {
+        StreamChecksum last = *this;
+        memset(last.partial + partialBytes, 0, BLOCK - partialBytes);
+        last.mix(last.partial);
+        uint64_t hash = total;
+        for (uint64_t lane : last.lanes) hash = (hash ^ lane) * 0x9E3779B97F4A7C15ULL + (hash >> 31);
+        return hash;
+    }
+};
+
+// Block-compressed store (version 3). Contacts are sorted by name and packed into blocks of about
+// BLOCK_TARGET_BYTES that decode on their own, given the shared domain dictionary:
+//   record: varint name prefix shared with the previous record | varint suffix length | suffix
+//           | varint phone header: length * 2 + 1 then two digits per byte, or length * 2 then bytes
+//           | email up to '@', front coded against the previous record's like the name
+//           | varint domain id (0: no '@')
+//           | varint zigzag(book position - previous position - 1)
+//   after the blocks: domain dictionary: u32 count, then u32 length + bytes each, most used first
+//                     block directory: u64 offset | u32 bytes | u32 records | u32 FNV-1a of the block
+//                                      | u32 length + first name | u32 length + last name
+//   trailer: u64 dictionary offset | u64 directory offset | u32 block count
+// Front coding restarts with every block, so finding a name decodes just the block covering it.
+// Neighbouring names often share a first name, and so do their email addresses.
+class BlockStore {
+public:
+    static constexpr size_t BLOCK_TARGET_BYTES = 4096;
+    static constexpr size_t TRAILER_SIZE = 20;
+
+    // One decoded block; each record's fields lie back to back in text
+    struct Decoded {
+        struct Record {
+            uint64_t position;   // Index in book order
+            uint32_t bounds[4];  // Name, phone and email start in text, then the end
+        };
+        string text;
+        vector<Record> records;
+
+        string_view field(const Record& record, int i) const {
+            return string_view(text).substr(record.bounds[i], record.bounds[i + 1] - record.bounds[i]);
+        }
+    };
+
+private:
+    struct Block {
+        uint64_t offset;
+        uint32_t bytes, records, checksum;
+        string_view firstName, lastName;
+    };
+    string_view data;
+    vector<Block> blocks;
+    vector<string_view> domains;
+    uint64_t count = 0, lsn = 0;
+
+    static void putFrontCoded(string& out, string_view text, string_view previous) {
+        size_t shared = 0, limit = min(text.size(), previous.size());
+        while (shared < limit && text[shared] == previous[shared]) ++shared;
+        putVarint(out, shared);
+        putVarint(out, text.size() - shared);
+        out += text.substr(shared);
+    }
+
+    // Rebuild text from the bytes at block[pos] and the previous record's value already in it
+    static bool getFrontCoded(string_view block, size_t& pos, string& text) {
+        uint64_t shared, suffix;
+        if (!getVarint(block, pos, shared) || !getVarint(block, pos, suffix) || shared > text.size() || block.size() - pos < suffix) return false;
+        text.resize(shared);
+        text.append(block.data() + pos, suffix);
+        pos += suffix;
+        return true;
+    }
+
+    static void putPhone(string& out, string_view phone) {
+        bool digits = all_of(phone.begin(), phone.end(), [](char c) { return c >= '0' && c <= '9'; });
+        putVarint(out, phone.size() * 2 + digits);
+        if (!digits) { out += phone; return; }
+        for (size_t i = 0; i < phone.size(); i += 2) {
+            int high = i + 1 < phone.size() ? phone[i + 1] - '0' : 0;
+            out += static_cast<char>((phone[i] - '0') | high << 4);
+        }
+    }
+
+    static bool getPhone(string_view block, size_t& pos, string& out) {
+        uint64_t header;
+        if (!getVarint(block, pos, header)) return false;
+        size_t length = header / 2, bytes = header & 1 ? (length + 1) / 2 : length;
+        if (block.size() - pos < bytes) return false;
+        if (!(header & 1)) {
+            out.append(block.data() + pos, length);
+        } else {
+            for (size_t i = 0; i < length; ++i) {
+                int digit = static_cast<unsigned char>(block[pos + i / 2]) >> (i % 2 * 4) & 0x0F;
+                if (digit > 9) return false;
+                out += static_cast<char>('0' + digit);
+            }
+        }
+        pos += bytes;
+        return true;
+    }
+
+    static bool getString(string_view data, size_t& pos, string_view& out) {
+        if (data.size() - pos < 4) return false;
+        size_t length = getU32(data.data() + pos);
+        pos += 4;
+        if (data.size() - pos < length) return false;
+        out = data.substr(pos, length);
+        pos += length;
+        return true;
+    }
+
+public:
+    // Stream contacts, book order given by their index, in this layout to write(string_view)
+    template <typename Write>
+    static void encode(const vector<Contact>& contacts, uint64_t lastLsn, Write write) {
+        vector<uint32_t> order(contacts.size());
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(), [&contacts](uint32_t a, uint32_t b) {
+            int compared = contacts[a].getName().compare(contacts[b].getName());
+            return compared != 0 ? compared < 0 : a < b;
+        });
+
+        // Domain ids by frequency, so the common domains take one byte
+        unordered_map<string_view, uint32_t> domainIds;
+        for (const auto& contact : contacts) {
+            size_t at = contact.getEmail().rfind('@');
+            if (at != string_view::npos) ++domainIds[contact.getEmail().substr(at + 1)];
+        }
+        vector<pair<string_view, uint32_t>> byUse(domainIds.begin(), domainIds.end());
+        sort(byUse.begin(), byUse.end(), [](const pair<string_view, uint32_t>& a, const pair<string_view, uint32_t>& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        string dictionary;
+        putU32(dictionary, byUse.size());
+        for (uint32_t i = 0; i < byUse.size(); ++i) {
+            domainIds[byUse[i].first] = i + 1;
+            putU32(dictionary, byUse[i].first.size());
+            dictionary += byUse[i].first;
+        }
+
+        string block(STORE_MAGIC, 4), directory;
+        putU32(block, STORE_VERSION_BLOCKS);
+        putU64(block, contacts.size());
+        putU64(block, lastLsn);
+        write(block);
+        uint64_t offset = block.size();
+        block.clear();
+        uint32_t blockCount = 0, blockRecords = 0;
+        string_view previousName, previousLocal, firstName;
+        int64_t previousPosition = -1;
+        auto finishBlock = [&]() {
+            putU64(directory, offset);
+            putU32(directory, block.size());
+            putU32(directory, blockRecords);
+            putU32(directory, fnv1a(block.data(), block.size()));
+            putU32(directory, firstName.size());
+            directory += firstName;
+            putU32(directory, previousName.size());
+            directory += previousName;
+            write(block);
+            offset += block.size();
+            block.clear();
+            blockRecords = 0;
+            ++blockCount;
+        };
+        for (uint32_t id : order) {
+            string_view name = contacts[id].getName(), email = contacts[id].getEmail();
+            if (blockRecords == 0) {
+                firstName = name;
+                previousName = previousLocal = string_view();
+                previousPosition = -1;
+            }
+            putFrontCoded(block, name, previousName);
+            putPhone(block, contacts[id].getPhone());
+            size_t at = email.rfind('@');
+            string_view local = email.substr(0, at);
+            putFrontCoded(block, local, previousLocal);
+            putVarint(block, at == string_view::npos ? 0 : domainIds[email.substr(at + 1)]);
+            int64_t delta = static_cast<int64_t>(id) - previousPosition - 1;
+            putVarint(block, static_cast<uint64_t>(delta) << 1 ^ static_cast<uint64_t>(delta >> 63));
+            previousName = name;
+            previousLocal = local;
+            previousPosition = id;
+            ++blockRecords;
+            if (block.size() >= BLOCK_TARGET_BYTES) finishBlock();
+        }
+        if (blockRecords > 0) finishBlock();
+
+        uint64_t directoryOffset = offset + dictionary.size();
+        string tail = move(dictionary);
+        tail += directory;
+        putU64(tail, offset);
+        putU64(tail, directoryOffset);
+        putU32(tail, blockCount);
+        write(tail);
+    }
+
+    // Read the header, dictionary and directory of a version 3 file; the blocks stay untouched
+    bool parse(string_view file) {
+        data = file;
+        blocks.clear();
+        domains.clear();
+        if (data.size() < STORE_HEADER_SIZE + TRAILER_SIZE || getU32(data.data() + 4) != STORE_VERSION_BLOCKS) return false;
+        count = getU64(data.data() + 8);
+        lsn = getU64(data.data() + 16);
+        const char* trailer = data.data() + data.size() - TRAILER_SIZE;
+        uint64_t dictionaryOffset = getU64(trailer), directoryOffset = getU64(trailer + 8);
+        uint32_t blockCount = getU32(trailer + 16);
+        size_t end = data.size() - TRAILER_SIZE;
+        if (dictionaryOffset < STORE_HEADER_SIZE || dictionaryOffset > directoryOffset || directoryOffset > end) return false;
+
+        string_view section = data.substr(0, directoryOffset);
+        size_t pos = dictionaryOffset;
+        if (section.size() - pos < 4) return false;
+        uint32_t domainCount = getU32(data.data() + pos);
+        pos += 4;
+        domains.resize(min<size_t>(domainCount, section.size()));
+        for (auto& domain : domains) {
+            if (!getString(section, pos, domain)) return false;
+        }
+        if (domains.size() != domainCount || pos != directoryOffset) return false;
+
+        section = data.substr(0, end);
+        uint64_t records = 0, expectedOffset = STORE_HEADER_SIZE;
+        blocks.reserve(min<size_t>(blockCount, section.size() / 28));
+        for (uint32_t i = 0; i < blockCount; ++i) {
+            if (section.size() - pos < 20) return false;
+            Block block;
+            block.offset = getU64(data.data() + pos);
+            block.bytes = getU32(data.data() + pos + 8);
+            block.records = getU32(data.data() + pos + 12);
+            block.checksum = getU32(data.data() + pos + 16);
+            pos += 20;
+            if (!getString(section, pos, block.firstName) || !getString(section, pos, block.lastName)) return false;
+            if (block.offset != expectedOffset || block.bytes > dictionaryOffset - block.offset || block.records > block.bytes) return false;
+            expectedOffset += block.bytes;
+            records += block.records;
+            blocks.push_back(block);
+        }
+        return pos == end && expectedOffset == dictionaryOffset && records == count;
+    }
+
+    uint64_t size() const { return count; }
+    uint64_t lastLsn() const { return lsn; }
+    size_t blockCount() const { return blocks.size(); }
+    size_t domainCount() const { return domains.size(); }
+
+    // Decode one block into out; false if it is damaged
+    bool decode(size_t index, Decoded& out) const {
+        const Block& block = blocks[index];
+        string_view bytes = data.substr(block.offset, block.bytes);
+        out.text.clear();
+        out.records.clear();
+        if (fnv1a(bytes.data(), bytes.size()) != block.checksum) return false;
+        out.text.reserve(bytes.size() * 2);
+        out.records.reserve(block.records);
+        string name, local;
+        size_t pos = 0;
+        int64_t previousPosition = -1;
+        for (uint32_t i = 0; i < block.records; ++i) {
+            Decoded::Record record;
+            uint64_t domain, delta;
+            if (!getFrontCoded(bytes, pos, name)) return false;
+            record.bounds[0] = out.text.size();
+            out.text += name;
+            record.bounds[1] = out.text.size();
+            if (!getPhone(bytes, pos, out.text)) return false;
+            record.bounds[2] = out.text.size();
+            if (!getFrontCoded(bytes, pos, local)) return false;
+            out.text += local;
+            if (!getVarint(bytes, pos, domain) || domain > domains.size()) return false;
+            if (domain > 0) {
+                out.text += '@';
+                out.text += domains[domain - 1];
+            }
+            record.bounds[3] = out.text.size();
+            if (!getVarint(bytes, pos, delta)) return false;
+            previousPosition += 1 + static_cast<int64_t>(delta >> 1 ^ (~(delta & 1) + 1));
+            if (previousPosition < 0 || static_cast<uint64_t>(previousPosition) >= count) return false;
+            record.position = previousPosition;
+            out.records.push_back(record);
+        }
+        return pos == bytes.size();
+    }
+
+    // Decode every block into contacts, in book order. The decoded text is kept in contactArena
+    // and the contacts view it.
+    bool readAll(vector<Contact>& contacts) const {
+        vector<Contact> byName;
+        vector<uint32_t> slot(count, UINT32_MAX); // Book position -> index in byName
+        byName.reserve(count);
+        Decoded decoded;
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (!decode(i, decoded)) return false;
+            string_view text = contactArena.adopt(move(decoded.text));
+            for (const auto& record : decoded.records) {
+                if (slot[record.position] != UINT32_MAX) return false;
+                slot[record.position] = byName.size();
+                auto field = [&](int f) { return text.substr(record.bounds[f], record.bounds[f + 1] - record.bounds[f]); };
+                byName.push_back(Contact::view(field(0), field(1), field(2)));
+            }
+        }
+        contacts.reserve(contacts.size() + count);
+        for (uint32_t index : slot) contacts.push_back(byName[index]); // Every slot is filled: count records, no repeats
+        return true;
+    }
+
+    // Visit (name, phone, email) of every stored contact with this name; returns how many blocks
+    // were decoded, normally one
+    template <typename Visit>
+    size_t find(string_view name, Visit visit) const {
+        auto first = lower_bound(blocks.begin(), blocks.end(), name, [](const Block& block, string_view key) { return block.lastName < key; });
+        size_t decodedBlocks = 0;
+        Decoded decoded;
+        for (auto it = first; it != blocks.end() && it->firstName <= name; ++it) {
+            ++decodedBlocks;
+            if (!decode(it - blocks.begin(), decoded)) break;
+            for (const auto& record : decoded.records) {
+                if (decoded.field(record, 0) == name) visit(decoded.field(record, 0), decoded.field(record, 1), decoded.field(record, 2));
+            }
+        }
+        return decodedBlocks;
+    }
+};
+
+// Read every record of the binary store into contacts. The file is either memory-mapped or read
+// with one bulk read; in both cases the contacts view its bytes directly instead of copying fields.
+// A block-compressed store is decoded instead. format reports the layout found.
+StoreStatus readStore(const string& path, vector<Contact>& contacts, uint64_t& lastLsn, bool mapFile, StoreFormat& format) {
+    string_view data;
+    if (mapFile) {
+        if (!storeMapping.open(path)) return filesystem::exists(path) ? StoreStatus::Corrupt : StoreStatus::Missing;
+        data = storeMapping.view();
+    } else {
+        ifstream file(path, ios::binary);
+        if (!file.is_open()) return StoreStatus::Missing;
+        data = contactArena.adopt(string(istreambuf_iterator<char>(file), istreambuf_iterator<char>())); // One bulk read
+    }
+
+    if (data.size() < STORE_HEADER_SIZE_V1 || data.compare(0, 4, string_view(STORE_MAGIC, 4)) != 0) return StoreStatus::Corrupt;
+    uint32_t version = getU32(data.data() + 4);
+    format = version == STORE_VERSION_BLOCKS ? StoreFormat::Blocks : StoreFormat::Plain;
+    if (version == STORE_VERSION_BLOCKS) {
+        BlockStore store;
+        if (!store.parse(data) || !store.readAll(contacts)) return StoreStatus::Corrupt;
+        lastLsn = store.lastLsn();
+        return StoreStatus::Ok;
+    }
+    if (version == 1) {
+        lastLsn = 0;
+    } else if (version == STORE_VERSION && data.size() >= STORE_HEADER_SIZE) {
+        lastLsn = getU64(data.data() + 16);
+    } else return StoreStatus::Corrupt;
+    uint64_t count = getU64(data.data() + 8);
+
+    size_t pos = version == 1 ? STORE_HEADER_SIZE_V1 : STORE_HEADER_SIZE;
+    string_view fields[3];
+    contacts.reserve(min<uint64_t>(count, data.size() / RECORD_HEADER_SIZE));
+    for (uint64_t i = 0; i < count; ++i) {
+        if (!decodeContact(data, pos, fields)) return StoreStatus::Corrupt;
+        contacts.push_back(Contact::view(fields[0], fields[1], fields[2]));
+    }
+    return StoreStatus::Ok;
+}
+
+// Stream all contacts to the binary store via a temporary file, so a crash never leaves it half-written.
+// With durable set the file is synced before the rename and the rename is synced after it.
+bool writeStore(const string& path, const vector<Contact>& contacts, uint64_t lastLsn, bool durable = false) {
+    string tmpPath = path + ".tmp";
+    FileWriter file;
+    if (!file.open(tmpPath)) return false;
+
+    if (storeFormat == StoreFormat::Blocks) {
+        BlockStore::encode(contacts, lastLsn, [&file](string_view bytes) { file.append(bytes); });
+    } else {
+        string record(STORE_MAGIC, 4);
+        putU32(record, STORE_VERSION);
+        putU64(record, contacts.size());
+        putU64(record, lastLsn);
+        file.append(record);
+        for (const auto& contact : contacts) {
+            record.clear();
+            encodeContact(record, contact);
+            file.append(record);
+        }
+    }
+    if ((durable && !file.sync()) || !file.close()) return false;
+    error_code ec;
+    filesystem::rename(tmpPath, path, ec);
+    if (!ec && durable) syncDirectory(path);
+    return !ec;
+}
+
+// The embedded format of earlier releases: contacts live in phonebook.cpp itself, one
+// "// name:phone:email" line each after the last DATA_SECTION marker line. With --embedded the book
+// stays there: an add appends its line and a delete appends a "//- <name, phone or email>"
+// tombstone, which removes the matching contacts again whenever the section is read.
+bool embeddedMode = false;
+const uint64_t EMBEDDED_COMPACT_MIN_DELETES = 256;
+
+// Offset just past the last line starting with the DATA_SECTION marker and the format legend
+// under it, or npos without a marker. Compacting the section then keeps the legend.
+size_t findDataSection(string_view source) {
+    size_t marker = source.rfind("\n// DATA_SECTION");
+    if (marker == string_view::npos) return string_view::npos;
+    size_t end = source.find('\n', marker + 1);
+    if (end == string_view::npos) return source.size();
+    if (source.compare(end + 1, 20, "// Add your contacts") == 0) {
+        end = source.find('\n', end + 1);
+        if (end == string_view::npos) return source.size();
+    }
+    return end + 1;
+}
+
+// Apply data section lines in order; anything that is neither a contact nor a tombstone is skipped
+void applyDataLines(string_view lines, ContactBook& contacts) {
+    size_t pos = 0;
+    while (pos < lines.size()) {
+        size_t end = min(lines.find('\n', pos), lines.size());
+        string_view line = lines.substr(pos, end - pos);
+        pos = end + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.rfind("//- ", 0) == 0) {
+            contacts.removeMatching(line.substr(4));
+        } else if (line.rfind("// ", 0) == 0 && line.rfind("// Add your contacts", 0) != 0) {
+            string_view entry = line.substr(3);
+            size_t pos1 = entry.find(':');
+            size_t pos2 = pos1 == string_view::npos ? pos1 : entry.find(':', pos1 + 1);
+            if (pos2 != string_view::npos) contacts.add(Contact(entry.substr(0, pos1), entry.substr(pos1 + 1, pos2 - pos1 - 1), entry.substr(pos2 + 1)));
+        }
+    }
+}
+
+// Write-ahead log (phonebook.db.wal): every mutation appends one record instead of rewriting the store,
+// and a bulk import appends a single record holding all of its contacts
+//   record: u8 op | u64 LSN | u32 payload length | payload | u32 FNV-1a checksum of everything before it
+// Startup replays records newer than the snapshot's LSN; a torn record at the tail is discarded.
+// Once the log outgrows half the snapshot, it is folded into a new snapshot.
+enum class WalOp : char { Add = 'A', Delete = 'D', Sort = 'S', Import = 'I' };
+const size_t WAL_RECORD_HEADER_SIZE = 13;
+const size_t WAL_CHECKSUM_SIZE = 4;
+const uint64_t WAL_COMPACT_MIN_BYTES = 64 * 1024;
+
+// When written records are synced to disk (--fsync=): after every write, at most FSYNC_INTERVAL
+// after they were written, or only on flush and exit. Snapshots are synced unless it is never.
+enum class FsyncPolicy { Always, Periodic, Never };
+FsyncPolicy fsyncPolicy = FsyncPolicy::Periodic;
+const chrono::milliseconds FSYNC_INTERVAL(1000);
+
+// Mutations never wait for the disk: append() only encodes its record into a pending buffer, and a
+// persistence thread writes whatever has piled up since its last pass with one write(), so a burst
+// of changes coalesces into a single system call. The same thread writes snapshots; a snapshot
+// still queued when a newer one is requested is replaced rather than written. flush() and close()
+// wait until everything appended so far is on disk. In embedded mode the log is the data section
+// of the source file: records are appended as its text lines, and a snapshot rewrites the section.
+class WriteAheadLog {
+private:
+    struct Snapshot {
+        vector<Contact> contacts;
+        vector<StringArena::Pin> pins; // Arena generations the contacts view
+        uint64_t lsn;      // Newest record it covers
+        uint64_t endBytes; // appendedBytes when it was taken; the log before that point is folded in
+    };
+
+    string storeFile;           // Snapshot the log is folded into
+    string logFile;             // Append-only mutation log
+    FileWriter log;             // Written only by the persistence thread once replay() has run
+    uint64_t nextLsn = 1;
+    uint64_t writtenLsn = 0;    // Newest record handed to the operating system
+    uint64_t syncedLsn = 0;     // Newest record known to be on disk
+    uint64_t syncTarget = 0;    // Newest record a flush() waits for
+    uint64_t appendedBytes = 0; // Log bytes ever appended, the replayed log included
+    uint64_t droppedBytes = 0;  // Bytes since folded into snapshots and cut from the front of the log
+    uint64_t snapshotBytes = 0; // Size of the current snapshot, scales the compaction threshold
+    bool embedded = false;      // Records are data section lines in logFile (--embedded)
+    uint64_t dataOffset = 0;    // Where the log starts in logFile: 0, or just past the DATA_SECTION marker
+    uint64_t baseBytes = 0;     // Embedded: compacted contact lines ahead of the log; persistence thread only
+    uint64_t tombstones = 0;    // Embedded: delete lines since the last snapshot was queued
+    string pending;             // Records not yet taken by the persistence thread
+    string writing;             // Records being written; swapped with pending so both keep their capacity
+    bool handOff = false;       // Write pending now instead of at the next commit()
+    bool compacting = false;    // The persistence thread is writing a snapshot
+    bool stopping = false;
+    optional<Snapshot> queued;  // Snapshot waiting for the persistence thread
+    mutex stateMutex;           // Guards everything above except log
+    condition_variable wake;    // Work for the persistence thread
+    condition_variable synced;  // syncedLsn moved, for flush()
+    atomic<bool> failed{false}; // A write failed; the log may be missing records from then on
+    thread writer;
+
+    void apply(ContactBook& contacts, WalOp op, const string& payload) {
+        if (op == WalOp::Add) {
+            size_t pos = 0;
+            string_view fields[3];
+            if (decodeContact(payload, pos, fields)) contacts.add(Contact(fields[0], fields[1], fields[2]));
+        } else if (op == WalOp::Import) { // Every contact of one import, back to back
+            size_t pos = 0;
+            string_view fields[3];
+            while (pos < payload.size() && decodeContact(payload, pos, fields)) contacts.add(Contact(fields[0], fields[1], fields[2]));
+        } else if (op == WalOp::Delete) {
+            contacts.removeMatching(payload);
+        } else if (op == WalOp::Sort) {
+            contacts.sortByName();
+        }
+    }
+
+    // Rewrite the source file with snapshot as its data section, keeping the code before the section
+    // and the lines appended after the snapshot was taken
+    bool rewriteDataSection(const Snapshot& snapshot, bool durable) {
+        log.close();
+        string source;
+        {
+            ifstream in(logFile, ios::binary);
+            source.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        }
+        uint64_t tailStart = dataOffset + baseBytes + (snapshot.endBytes - droppedBytes);
+        string tmpPath = logFile + ".tmp";
+        FileWriter tmp;
+        uint64_t lineBytes = 0;
+        bool rewritten = tailStart <= source.size() && tmp.open(tmpPath);
+        if (rewritten) {
+            tmp.append(string_view(source).substr(0, dataOffset));
+            string line;
+            for (const Contact& contact : snapshot.contacts) {
+                line.assign("// ");
+                contact.appendTo(line);
+                line += '\n';
+                tmp.append(line);
+                lineBytes += line.size();
+            }
+            tmp.append(string_view(source).substr(tailStart));
+            rewritten = (!durable || tmp.sync()) && tmp.close();
+        }
+        error_code ec;
+        if (rewritten) filesystem::rename(tmpPath, logFile, ec);
+        if (rewritten && !ec && durable) syncDirectory(logFile);
+        if (!log.open(logFile, true)) failed = true;
+        if (!rewritten || ec) return false;
+        baseBytes = lineBytes;
+        return true;
+    }
+
+    // Write snapshot as the store, then cut the records it covers from the front of the log
+    bool compact(const Snapshot& snapshot) {
+        bool durable = fsyncPolicy != FsyncPolicy::Never;
+        if (embedded) return rewriteDataSection(snapshot, durable);
+        if (!writeStore(storeFile, snapshot.contacts, snapshot.lsn, durable)) return false;
+        log.close();
+        string tail;
+        {
+            ifstream in(logFile, ios::binary);
+            in.seekg(snapshot.endBytes - droppedBytes);
+            tail.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>()); // Records newer than the snapshot
+        }
+        string tmpPath = logFile + ".tmp";
+        FileWriter tmp;
+        bool rewritten = tmp.open(tmpPath);
+        if (rewritten) {
+            tmp.append(tail);
+            rewritten = (!durable || tmp.sync()) && tmp.close();
+        }
+        error_code ec;
+        if (rewritten) filesystem::rename(tmpPath, logFile, ec);
+        if (rewritten && !ec && durable) syncDirectory(logFile);
+        if (!log.open(logFile, true)) failed = true;
+        return rewritten && !ec;
+    }
+
+    // The persistence thread: take everything pending and any queued snapshot, write them without
+    // holding the lock, and repeat until close() asks it to stop with nothing left
+    void run() {
+        unique_lock<mutex> lock(stateMutex);
+        auto lastSync = chrono::steady_clock::now();
+        auto ready = [this] { return stopping || handOff || queued || (syncedLsn < syncTarget && !failed); };
+        while (true) {
+            if (fsyncPolicy == FsyncPolicy::Periodic && syncedLsn < writtenLsn) wake.wait_until(lock, lastSync + FSYNC_INTERVAL, ready);
+            else wake.wait(lock, ready);
+
+            writing.swap(pending);
+            handOff = false;
+            uint64_t lsn = nextLsn - 1; // Every record taken is at or before it
+            auto now = chrono::steady_clock::now();
+            bool sync = fsyncPolicy == FsyncPolicy::Always || syncedLsn < syncTarget || stopping ||
+                        (fsyncPolicy == FsyncPolicy::Periodic && now - lastSync >= FSYNC_INTERVAL);
+            optional<Snapshot> snapshot;
+            snapshot.swap(queued);
+            compacting = snapshot.has_value();
+            lock.unlock();
+
+            bool ok = true;
+            if (!writing.empty()) {
+                log.append(writing);
+                ok = log.flush();
+            }
+            if (ok && sync && syncedLsn < lsn) ok = log.sync();
+            if (writing.capacity() > (1 << 20)) string().swap(writing); // Don't hold on to an import's worth
+            else writing.clear();
+            bool folded = ok && snapshot && compact(*snapshot);
+
+            lock.lock();
+            if (!ok) failed = true;
+            if (ok) writtenLsn = lsn;
+            if (ok && sync) {
+                syncedLsn = lsn;
+                lastSync = now;
+            }
+            if (folded) {
+                droppedBytes = snapshot->endBytes;
+                error_code ec;
+                snapshotBytes = filesystem::file_size(storeFile, ec);
+            }
+            compacting = false;
+            synced.notify_all();
+            if (stopping && ((pending.empty() && !queued) || failed)) return;
+        }
+    }
+
+    // Open the log for appending and start the persistence thread; stateMutex is held
+    void start() {
+        writtenLsn = syncedLsn = syncTarget = nextLsn - 1;
+        error_code ec;
+        snapshotBytes = filesystem::file_size(storeFile, ec);
+        if (ec) snapshotBytes = 0;
+        if (!log.open(logFile, true)) failed = true;
+        if (!writer.joinable()) writer = thread(&WriteAheadLog::run, this);
+    }
+
+    // The data section lines for one mutation. A sort has none: compaction stores the new order.
+    void appendLines(WalOp op, string_view payload) {
+        if (op == WalOp::Delete) {
+            pending += "//- ";
+            pending.append(payload.data(), payload.size());
+            pending += '\n';
+            ++tombstones;
+            return;
+        }
+        size_t pos = 0;
+        string_view fields[3];
+        while (pos < payload.size() && decodeContact(payload, pos, fields)) {
+            pending += "// ";
+            Contact::view(fields[0], fields[1], fields[2]).appendTo(pending);
+            pending += '\n';
+        }
+    }
+
+public:
+    WriteAheadLog(const string& store, const string& log) : storeFile(store), logFile(log) {}
+    ~WriteAheadLog() { close(); }
+
+    // Keep the book in the data section of source instead of the store and its log (--embedded)
+    void useDataSection(const string& source) {
+        embedded = true;
+        logFile = source;
+    }
+
+    // Point a closed log at other files, starting over from an empty log. The benchmark runs the
+    // command paths against scratch files this way.
+    void useFiles(const string& store, const string& log) {
+        lock_guard<mutex> lock(stateMutex);
+        storeFile = store;
+        logFile = log;
+        nextLsn = 1;
+        appendedBytes = droppedBytes = 0;
+        pending.clear();
+        stopping = false;
+        failed = false;
+    }
+
+    // Apply logged mutations newer than snapshotLsn, then open the log and start the persistence thread
+    void replay(ContactBook& contacts, uint64_t snapshotLsn) {
+        lock_guard<mutex> lock(stateMutex);
+        string data;
+        {
+            ifstream in(logFile, ios::binary);
+            if (in.is_open()) data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        }
+
+        size_t pos = 0;
+        nextLsn = snapshotLsn + 1;
+        if (embedded) {
+            dataOffset = findDataSection(data);
+            if (dataOffset == string::npos) { // Start a data section at the end of the file
+                if (!data.empty() && data.back() != '\n') pending += '\n';
+                pending += "// DATA_SECTION\n// Add your contacts below this line as comments in format: // name:phone:email\n";
+                dataOffset = data.size() + pending.size();
+            } else {
+                applyDataLines(string_view(data).substr(dataOffset), contacts);
+                if (data.back() != '\n') { // New lines must not join the last one
+                    pending += '\n';
+                    if (dataOffset == data.size()) ++dataOffset; // The newline ends the legend, not the log
+                }
+                appendedBytes = data.size() - dataOffset + pending.size();
+            }
+            data.clear(); // Nothing for the record loop below
+        }
+        while (data.size() - pos >= WAL_RECORD_HEADER_SIZE + WAL_CHECKSUM_SIZE) {
+            WalOp op = static_cast<WalOp>(data[pos]);
+            uint64_t lsn = getU64(data.data() + pos + 1);
+            size_t length = getU32(data.data() + pos + 9);
+            if (data.size() - pos - WAL_RECORD_HEADER_SIZE - WAL_CHECKSUM_SIZE < length) break;
+            size_t body = WAL_RECORD_HEADER_SIZE + length;
+            if (fnv1a(data.data() + pos, body) != getU32(data.data() + pos + body)) break;
+
+            if (lsn > snapshotLsn) apply(contacts, op, data.substr(pos + WAL_RECORD_HEADER_SIZE, length));
+            nextLsn = max(nextLsn, lsn + 1);
+            pos += body + WAL_CHECKSUM_SIZE;
+        }
+
+        error_code ec;
+        if (pos < data.size()) filesystem::resize_file(logFile, pos, ec); // Drop a torn tail record
+        if (!embedded) appendedBytes = pos;
+        start();
+    }
+
+    // Carry on from where a clean exit left the log, as recorded in the startup cache, instead of
+    // replaying it: lastLsn is the newest record and sectionOffset the embedded log's start
+    void resume(uint64_t lastLsn, uint64_t sectionOffset) {
+        lock_guard<mutex> lock(stateMutex);
+        error_code ec;
+        uint64_t size = filesystem::file_size(logFile, ec);
+        nextLsn = lastLsn + 1;
+        dataOffset = embedded ? sectionOffset : 0;
+        appendedBytes = ec || size < dataOffset ? 0 : size - dataOffset;
+        start();
+    }
+
+    // What resume() needs; read by the thread that appends, or once close() has returned
+    uint64_t lastLsn() const { return nextLsn - 1; }
+    uint64_t sectionOffset() const { return dataOffset; }
+
+    // Queue one mutation record for the persistence thread; false once a write has failed. With
+    // flush unset the record waits for the next commit() (or the thread's next pass).
+    bool append(WalOp op, string_view payload, bool flush = true) {
+        {
+            lock_guard<mutex> lock(stateMutex);
+            size_t start = pending.size();
+            if (embedded) {
+                appendLines(op, payload);
+            } else {
+                pending += static_cast<char>(op);
+                putU64(pending, nextLsn);
+                putU32(pending, payload.size());
+                pending.append(payload.data(), payload.size());
+                putU32(pending, fnv1a(pending.data() + start, pending.size() - start));
+            }
+            ++nextLsn;
+            appendedBytes += pending.size() - start;
+            if (flush) handOff = true;
+        }
+        if (flush) wake.notify_one();
+        return !failed;
+    }
+
+    // Have the persistence thread write every queued record now. With wait set, return once they
+    // are written (and synced, under --fsync=always); false if a write failed.
+    bool commit(bool wait = false) {
+        unique_lock<mutex> lock(stateMutex);
+        uint64_t target = nextLsn - 1;
+        handOff = true;
+        wake.notify_one();
+        if (!wait || !writer.joinable()) return !failed;
+        synced.wait(lock, [this, target] { return (fsyncPolicy == FsyncPolicy::Always ? syncedLsn : writtenLsn) >= target || failed; });
+        return !failed;
+    }
+
+    // Wait until every record appended so far is written and synced, whatever the fsync policy
+    bool flush() {
+        unique_lock<mutex> lock(stateMutex);
+        if (!writer.joinable()) return !failed;
+        syncTarget = max(syncTarget, nextLsn - 1);
+        wake.notify_one();
+        synced.wait(lock, [this] { return syncedLsn >= syncTarget || failed; });
+        return !failed;
+    }
+
+    // Write and sync everything queued, finish a queued snapshot, then stop the persistence thread
+    bool close() {
+        {
+            lock_guard<mutex> lock(stateMutex);
+            if (!writer.joinable()) return !failed;
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+        log.close();
+        return !failed;
+    }
+
+    // Queue a snapshot once the log has grown large relative to the current one (embedded: once
+    // deletes reach half the book), or right away when forced. Taking it copies the contacts'
+    // views, not their bytes; the writing happens on the persistence thread.
+    void compactIfNeeded(const ContactBook& contacts, bool force = false) {
+        uint64_t lsn, endBytes;
+        {
+            lock_guard<mutex> lock(stateMutex);
+            if (!writer.joinable()) return;
+            // The data section only needs compacting once tombstones pile up; appended lines are final
+            bool due = embedded ? tombstones >= max<uint64_t>(EMBEDDED_COMPACT_MIN_DELETES, contacts.size() / 2)
+                                : appendedBytes - droppedBytes >= max(WAL_COMPACT_MIN_BYTES, snapshotBytes / 2);
+            if (!force && (compacting || queued || !due)) return;
+            lsn = nextLsn - 1;
+            endBytes = appendedBytes;
+            tombstones = 0;
+        }
+        Snapshot snapshot{ contacts.snapshot(), contacts.pins(), lsn, endBytes };
+        {
+            lock_guard<mutex> lock(stateMutex);
+            queued = move(snapshot); // Supersedes a queued snapshot the thread has not started on
+        }
+        wake.notify_one();
+    }
+};
+
+WriteAheadLog wal(STORE_FILE, STORE_FILE + ".wal");
+
+// Startup cache (phonebook.db.cache, or phonebook.cpp.cache with --embedded): the book as a clean
+// exit left it, with every index built by then, so the next start maps one file instead of parsing
+// the store and replaying the log.
+//   header:  "PBSC" | u32 version | u32 byte order mark | u64 hash probe | u32 store format
+//            | u64 last LSN | u64 data section offset | u32 source count
+//            | per source: u64 size | u64 modification time | u64 checksum of its last 64 KiB
+//   body:    the ContactBook image
+//   trailer: u64 StreamChecksum of everything before it
+// The cache is only used while every source still has the recorded size, time and tail checksum,
+// and only by a build that lays arrays out and hashes strings the same way (the mark and probe).
+const char CACHE_MAGIC[4] = { 'P', 'B', 'S', 'C' };
+const uint32_t CACHE_VERSION = 1;
+const uint32_t CACHE_BYTE_ORDER = 0x01020304;
+const uint64_t CACHE_TAIL_BYTES = 64 * 1024;
+bool cacheEnabled = true; // --no-cache turns it off
+
+struct SourceStamp {
+    uint64_t size = 0;
+    uint64_t modified = 0;
+    uint64_t tail = 0;
+
+    bool operator==(const SourceStamp& other) const { return size == other.size && modified == other.modified && tail == other.tail; }
+};
+
+MappedFile cacheMapping;          // Backs the contacts of a cached start, must outlive them
+vector<SourceStamp> cachedSources; // Sources as the loaded cache recorded them
+uint64_t cachedIndexes = 0;
+bool cacheLoaded = false;
+
+string cachePath() { return embeddedMode ? string(PHONEBOOK_SOURCE) + ".cache" : STORE_FILE + ".cache"; }
+
+// Stamp the files the book is loaded from; false if one is missing (the book would then come from
+// somewhere else, such as the legacy import)
+bool stampSources(vector<SourceStamp>& stamps) {
+    vector<string> paths = embeddedMode ? vector<string>{ PHONEBOOK_SOURCE } : vector<string>{ STORE_FILE, STORE_FILE + ".wal" };
+    stamps.clear();
+    for (const string& path : paths) {
+        error_code ec;
+        SourceStamp stamp;
+        stamp.size = filesystem::file_size(path, ec);
+        if (ec) return false;
+        stamp.modified = filesystem::last_write_time(path, ec).time_since_epoch().count();
+        if (ec) return false;
+        ifstream in(path, ios::binary);
+        string tail(min(stamp.size, CACHE_TAIL_BYTES), '\0');
+        in.seekg(stamp.size - tail.size());
+        if (!in.read(&tail[0], tail.size())) return false;
+        StreamChecksum checksum;
+        checksum.update(tail.data(), tail.size());
+        stamp.tail = checksum.value();
+        stamps.push_back(stamp);
+    }
+    return true;
+}
+
+// Load the book from the startup cache and resume the log after it; false (with the book empty)
+// when there is no cache or it does not match the sources
+bool loadStartupCache(ContactBook& book) {
+    vector<SourceStamp> stamps;
+    if (!cacheEnabled || !stampSources(stamps) || !cacheMapping.open(cachePath())) return false;
+    string_view data = cacheMapping.view();
+    size_t headerSize = 44 + stamps.size() * 24;
+    uint32_t byteOrder = 0;
+    if (data.size() >= headerSize) memcpy(&byteOrder, data.data() + 8, sizeof(byteOrder));
+    bool valid = data.size() >= headerSize + 8 && data.compare(0, 4, string_view(CACHE_MAGIC, 4)) == 0 &&
+                 getU32(data.data() + 4) == CACHE_VERSION && byteOrder == CACHE_BYTE_ORDER &&
+                 getU64(data.data() + 12) == hash<string_view>()("phonebook") && getU32(data.data() + 40) == stamps.size();
+    for (size_t i = 0; valid && i < stamps.size(); ++i) {
+        const char* at = data.data() + 44 + i * 24;
+        valid = stamps[i] == SourceStamp{ getU64(at), getU64(at + 8), getU64(at + 16) };
+    }
+    StoreFormat format = valid && getU32(data.data() + 20) == 1 ? StoreFormat::Blocks : StoreFormat::Plain; // Header checked first
+    if (valid && storeFormatChosen && format != storeFormat) valid = false; // Let the normal load convert it
+    if (valid) { // Pages are released behind the checksum; loading faults them back in from the page cache
+        StreamChecksum checksum;
+        const size_t CHUNK = 32 << 20;
+        for (size_t at = 0; at < data.size() - 8; at += CHUNK) {
+            checksum.update(data.data() + at, min(CHUNK, data.size() - 8 - at));
+            cacheMapping.release(at, CHUNK);
+        }
+        valid = checksum.value() == getU64(data.data() + data.size() - 8);
+    }
+    ImageReader in(valid ? data.substr(headerSize, data.size() - 8 - headerSize) : string_view(), &cacheMapping);
+    if (!valid || !book.load(in)) {
+        cacheMapping.close();
+        return false;
+    }
+    in.consumed(); // Only the field bytes are still needed
+    if (!storeFormatChosen) storeFormat = format;
+    wal.resume(getU64(data.data() + 24), getU64(data.data() + 32));
+    cachedSources = stamps;
+    cachedIndexes = book.builtIndexes();
+    cacheLoaded = true;
+    return true;
+}
+
+// Write the startup cache once the log is closed and the sources no longer change. Nothing is
+// written when the cache loaded at startup still matches; the cache is not synced, since a torn
+// one fails its checksum and the book is then simply loaded the slow way.
+void saveStartupCache(const ContactBook& book) {
+    vector<SourceStamp> stamps;
+    if (!cacheEnabled || !stampSources(stamps)) return;
+    if (cacheLoaded && stamps == cachedSources && book.builtIndexes() == cachedIndexes) return;
+    string path = cachePath(), tmpPath = path + ".tmp";
+    FileWriter file;
+    if (!file.open(tmpPath)) return;
+    StreamChecksum checksum;
+    auto emit = [&](string_view bytes) {
+        checksum.update(bytes.data(), bytes.size());
+        file.append(bytes);
+    };
+    string header(CACHE_MAGIC, 4);
+    putU32(header, CACHE_VERSION);
+    header.append(reinterpret_cast<const char*>(&CACHE_BYTE_ORDER), sizeof(CACHE_BYTE_ORDER));
+    putU64(header, hash<string_view>()("phonebook"));
+    putU32(header, storeFormat == StoreFormat::Blocks ? 1 : 0);
+    putU64(header, wal.lastLsn());
+    putU64(header, wal.sectionOffset());
+    putU32(header, stamps.size());
+    for (const SourceStamp& stamp : stamps) {
+        putU64(header, stamp.size);
+        putU64(header, stamp.modified);
+        putU64(header, stamp.tail);
+    }
+    emit(header);
+    book.save(emit);
+    string trailer;
+    putU64(trailer, checksum.value());
+    file.append(trailer);
+    error_code ec;
+    if (file.close()) filesystem::rename(tmpPath, path, ec);
+    else filesystem::remove(tmpPath, ec);
+}
+
+// One-time importer for the data section of phonebook.cpp, used while there is no store yet
+vector<Contact> importLegacyContacts() {
+    ifstream file(PHONEBOOK_SOURCE, ios::binary);
+    if (!file.is_open()) return {};
+    string source;
+    source.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    size_t offset = findDataSection(source);
+    if (offset == string::npos) return {};
+    ContactBook book;
+    applyDataLines(string_view(source).substr(offset), book);
+    return book.snapshot(); // The fields were copied into the arena, so they outlive source
+}
+
+// Load the book from the startup cache when it is current; otherwise load the binary store snapshot,
+// import the legacy DATA_SECTION on first run, then replay the log (with --embedded, the data
+// section of phonebook.cpp is both)
+ContactBook loadContacts(bool mapStore) {
+    ContactBook book;
+    if (embeddedMode) wal.useDataSection(PHONEBOOK_SOURCE);
+    if (loadStartupCache(book)) return book;
+    if (embeddedMode) {
+        wal.replay(book, 0);
+        return book;
+    }
+    vector<Contact> contacts;
+    uint64_t snapshotLsn = 0;
+    StoreFormat found = storeFormat;
+    StoreStatus status = readStore(STORE_FILE, contacts, snapshotLsn, mapStore, found);
+    bool convert = storeFormatChosen && (status != StoreStatus::Ok || found != storeFormat);
+    if (status == StoreStatus::Ok && !storeFormatChosen) storeFormat = found; // Keep the store's own format
+    if (status == StoreStatus::Corrupt) { // Keep the damaged file aside instead of overwriting it
+        contacts.clear();
+        snapshotLsn = 0;
+        rename(STORE_FILE.c_str(), (STORE_FILE + ".corrupt").c_str());
+        setColor(RED); term << "Contact store is corrupt, moved to " << STORE_FILE << ".corrupt\n"; setColor(WHITE);
+    } else if (status == StoreStatus::Missing) {
+        contacts = importLegacyContacts();
+        if (!contacts.empty()) writeStore(STORE_FILE, contacts, 0); // Migrate legacy contacts once
+    }
+    book.assign(move(contacts));
+    wal.replay(book, snapshotLsn);
+    if (convert) wal.compactIfNeeded(book, true); // Rewrite the snapshot in the requested format
+    return book;
+}
+
+// Batch mode (--batch): commands come from a script, banners and screen clearing are skipped,
+// and each command reports one JSON line instead of colored messages
+bool batchMode = false;
+
+enum class Outcome { Ok, Warning, Error };
+
+// What the running command reported, collected for its batch result line
+struct BatchResult {
+    Outcome outcome = Outcome::Ok;
+    string message;
+    string results; // Comma-separated JSON objects for the contacts the command returned
+
+    // Start the next command, keeping the buffers unless a huge result made them large
+    void clear() {
+        outcome = Outcome::Ok;
+        message.clear();
+        if (results.capacity() > (1 << 20)) string().swap(results);
+        else results.clear();
+    }
+};
+thread_local BatchResult batchResult; // Per thread, so server threads each report their own request
+
+// JSON string literal for value; the "-" placeholder becomes null
+void appendJsonString(string& out, string_view value) {
+    if (value == "-") { out += "null"; return; }
+    out += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') out += '\\', out += c;
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else out += c;
+    }
+    out += '"';
+}
+
+// Tell the user how a command went: a colored headline plus plain detail, or in batch mode the
+// command's status (the most severe report wins)
+void report(Outcome outcome, string_view headline, string_view detail = {}) {
+    if (batchMode) {
+        if (outcome < batchResult.outcome) return;
+        batchResult.outcome = outcome;
+        batchResult.message.assign(headline).append(detail);
+        return;
+    }
+    setColor(outcome == Outcome::Ok ? GREEN : outcome == Outcome::Warning ? YELLOW : RED);
+    term << headline;
+    setColor(WHITE);
+    term << detail << '\n';
+}
+
+// Add a contact to the batch result list
+void reportContact(const Contact& contact) {
+    string& out = batchResult.results;
+    if (!out.empty()) out += ',';
+    out += "{\"name\":";
+    appendJsonString(out, contact.getName());
+    out += ",\"phone\":";
+    appendJsonString(out, contact.getPhone());
+    out += ",\"email\":";
+    appendJsonString(out, contact.getEmail());
+    out += '}';
+}
+
+// Record a mutation in the write-ahead log and fold the log into a snapshot when it grows large.
+// In batch mode records are only flushed when the batch commits
+void logMutation(const ContactBook& contacts, WalOp op, string_view payload) {
+    if (!wal.append(op, payload, !batchMode)) {
+        report(Outcome::Error, "Failed to write " + STORE_FILE + ".wal!");
+        return;
+    }
+    // A logged sort would be redone on every startup; folding it in right away stores the book
+    // in name order, which the name index then picks up in a single pass
+    wal.compactIfNeeded(contacts, op == WalOp::Sort);
+}
+
+const size_t LIST_PAGE_SIZE = 25;
+
+void printTableHeader() {
+    setColor(BLUE); // Darker blue for borders
+    term << "\n=======================================================================================================+\n";
+    setColor(CYAN); // Darker cyan for title
+    term << "|                                    *** PHONEBOOK CONTACTS ***                                        |\n";
+    setColor(BLUE);
+    term << "+===================================+=======================+==========================================+\n";
+    term << "|               NAME                |         PHONE         |                   EMAIL                  |\n";
+    term << "+===================================+=======================+==========================================+\n";
+}
+
+void printContactRow(const Contact& contact) {
+    setColor(WHITE);
+    term << "| ";
+    setColor(LIGHT_CYAN); // Soft cyan for names
+    term << terminal::pad(contact.getName().substr(0, 33), 34);
+    setColor(WHITE);
+    term << "| ";
+    setColor(LIGHT_GRAY); // Soft gray for phone numbers
+    term << terminal::pad(contact.getPhone().substr(0, 21), 22);
+    setColor(WHITE);
+    term << "| ";
+    setColor(DARK_YELLOW); // Soft dark yellow for emails
+    term << terminal::pad(contact.getEmail().substr(0, 40), 41);
+    setColor(WHITE);
+    term << "|\n";
+    setColor(BLUE);
+    term << "+-----------------------------------+-----------------------+------------------------------------------+\n";
+}
+
+// Display contacts in a formatted table, one page at a time: list [page] [size] | list --stream.
+// A page is formatted into the terminal buffer and written with a single syscall, so the cost
+// follows the rows shown, not the size of the book. --stream renders every page in turn.
+void displayContacts(const ContactBook& contacts, const vector<string_view>& params) {
+    if (contacts.empty()) {
+        if (!batchMode) { setColor(LIGHT_GRAY); term << "\n  *** Phonebook is empty! ***\n"; setColor(WHITE); }
+        return;
+    }
+    bool stream = false;
+    size_t numbers[2] = { 0, 0 }, given = 0; // Page and page size
+    for (string_view param : params) {
+        if (param == "--stream") stream = true;
+        else if (given < 2 && allDigits(param)) numbers[given++] = parseInt(param.substr(0, 9));
+    }
+    size_t pageSize = given > 1 && numbers[1] > 0 ? numbers[1] : LIST_PAGE_SIZE;
+    size_t pageCount = (contacts.size() + pageSize - 1) / pageSize;
+    size_t page = given == 0 || numbers[0] == 0 ? 1 : min(numbers[0], pageCount);
+    size_t lastPage = stream ? pageCount : page;
+
+    if (batchMode) { // Every contact unless a page was asked for
+        if (given == 0 || stream) contacts.forEach(reportContact);
+        else contacts.forEachInRange((page - 1) * pageSize, pageSize, reportContact);
+        return;
+    }
+    for (; page <= lastPage; ++page) {
+        if (!stream || page == 1) printTableHeader();
+        contacts.forEachInRange((page - 1) * pageSize, pageSize, printContactRow);
+        if (page == lastPage) {
+            setColor(CYAN);
+            term << "# TOTAL CONTACTS: ";
+            setColor(YELLOW); // Slightly brighter yellow for total count
+            term << terminal::pad(to_string(contacts.size()), 17);
+            if (!stream && pageCount > 1) {
+                setColor(WHITE);
+                term << "  page " << page << " of " << pageCount << " (list <page> [size], list --stream)";
+            }
+            term << '\n';
+            setColor(WHITE);
+        }
+        term.flush(); // One write per page
+    }
+}
+
+// Threads for scanning searches (--threads=N); 0 uses every hardware thread
+size_t searchThreads = 0;
+const size_t PARALLEL_SCAN_MIN = 64 * 1024; // Smaller books scan faster on one thread
+
+WorkStealingPool& searchPool() {
+    static WorkStealingPool pool(searchThreads > 0 ? searchThreads : thread::hardware_concurrency());
+    return pool;
+}
+
+// Search contacts by name, phone, or email
+// With prefix set, only names starting with query match, listed in name order. Queries too short
+// for the trigram index scan the book, in parallel shards when it is large.
+void searchContacts(const ContactBook& contacts, string_view query, bool prefix = false) {
+    bool found = false;
+    auto show = [&found](const Contact& contact) {
+        found = true;
+        if (batchMode) { reportContact(contact); return; }
+        setColor(GREEN); 
+        term << contact.getName() << " - " << contact.getPhone() << " - " << contact.getEmail() << '\n';
+        setColor(WHITE);
+    };
+    if (prefix) contacts.searchPrefix(query, show);
+    else if (query.size() < TrigramIndex::MIN_QUERY && contacts.size() >= PARALLEL_SCAN_MIN && searchPool().size() > 1) {
+        contacts.parallelScan(query, searchPool(), false, show);
+    }
+    else contacts.search(query, show);
+    if (!found) {
+        report(Outcome::Warning, "No matching contacts found!");
+    }
+}
+
+// Typo-tolerant name search: contacts within k edits of query, nearest first
+void fuzzySearch(const ContactBook& contacts, string_view query, uint32_t k) {
+    bool found = false;
+    size_t computed = contacts.searchFuzzy(query, k, [&found](uint32_t distance, const Contact& contact) {
+        found = true;
+        if (batchMode) { reportContact(contact); return; }
+        setColor(GREEN);
+        term << contact.getName() << " - " << contact.getPhone() << " - " << contact.getEmail();
+        setColor(LIGHT_GRAY);
+        term << "  (" << distance << (distance == 1 ? " edit)\n" : " edits)\n");
+        setColor(WHITE);
+    });
+    if (!found) {
+        report(Outcome::Warning, "No names within " + to_string(k) + " edits!");
+    }
+    if (!batchMode) {
+        setColor(LIGHT_GRAY); term << "Compared against " << computed << " of " << contacts.fuzzyNameCount() << " distinct names\n"; setColor(WHITE);
+    }
+}
+
+// Print a contact found by one of the phone lookups
+void showPhoneMatch(const Contact& contact) {
+    if (batchMode) { reportContact(contact); return; }
+    setColor(GREEN);
+    term << contact.getPhone() << " - " << contact.getName() << " - " << contact.getEmail() << '\n';
+    setColor(WHITE);
+}
+
+// Caller-ID lookup: the contacts with this phone or, failing that, with the longest phone the
+// number starts with (e.g. a switchboard number for one of its extensions)
+void lookupPhone(const ContactBook& contacts, string_view input) {
+    string number = phoneDigits(input);
+    if (!allDigits(number)) {
+        report(Outcome::Error, "Phone numbers may only contain digits!");
+        return;
+    }
+    size_t matched = contacts.lookupPhone(number, showPhoneMatch);
+    if (matched == 0) report(Outcome::Warning, "No contact's phone matches " + number + "!");
+    else if (matched < number.size()) report(Outcome::Ok, "Longest matching prefix: ", number.substr(0, matched));
+}
+
+// List contacts whose phone starts with the given digits, in phone order
+void phonePrefixSearch(const ContactBook& contacts, string_view input) {
+    string prefix = phoneDigits(input);
+    if (!allDigits(prefix)) {
+        report(Outcome::Error, "Phone numbers may only contain digits!");
+        return;
+    }
+    bool found = false;
+    contacts.searchPhonePrefix(prefix, [&found](const Contact& contact) {
+        found = true;
+        showPhoneMatch(contact);
+    });
+    if (!found) report(Outcome::Warning, "No phone numbers start with " + prefix + "!");
+}
+
+// Delete a contact by name, phone, or email; returns whether one was removed
+bool deleteContact(ContactBook& contacts, string_view query) {
+    if (contacts.removeMatching(query)) {
+        logMutation(contacts, WalOp::Delete, query);
+        report(Outcome::Ok, "Contact deleted permanently!");
+        return true;
+    }
+    report(Outcome::Warning, "Contact not found!");
+    return false;
+}
+
+// Check for duplicate names, allowing multiple "Unknown" or "-"
+bool hasDuplicateName(const ContactBook& contacts, string_view name) {
+    return name != "Unknown" && name != "-" && contacts.countName(name) > 0;
+}
+
+// Add a contact with flexible parameters; returns the contact added, or nullptr
+const Contact* addContact(ContactBook& contacts, const vector<string_view>& params) {
+    if (params.empty()) {
+        report(Outcome::Error, "Please provide at least one parameter!");
+        return nullptr;
+    }
+
+    string_view name = "-", phone = "-", email = "-";
+    bool nameSet = false;
+
+    for (string_view param : params) {
+        if (isPhone(param) && phone == "-") phone = param;
+        else if (isEmail(param) && email == "-") email = param;
+        else if (isName(param) && !nameSet) {
+            name = param;
+            nameSet = true;
+        }
+    }
+
+    if (!isValidName(name)) {
+        report(Outcome::Error, "Invalid name! Must be 1-50 characters (letters, digits, spaces, -, ' only).");
+        return nullptr;
+    }
+    if (hasDuplicateName(contacts, name)) {
+        report(Outcome::Warning, "Record with name '" + string(name) + "' already exists!");
+        return nullptr;
+    }
+    if (!isValidPhone(phone)) {
+        report(Outcome::Error, "Invalid phone number! Must be 8-15 digits.");
+        return nullptr;
+    }
+    if (!isValidEmail(email)) {
+        report(Outcome::Error, "Invalid email format!");
+        return nullptr;
+    }
+
+    static string record; // Reused, so adding only allocates when the book or its indexes grow
+    record.clear();
+    const Contact& added = contacts.add(Contact(name, phone, email));
+    encodeContact(record, added);
+    logMutation(contacts, WalOp::Add, record);
+    report(Outcome::Ok, "Contact added!");
+    return &added;
+}
+
+// Sort contacts alphabetically by name
+void sortContacts(ContactBook& contacts) {
+    contacts.sortByName();
+    logMutation(contacts, WalOp::Sort, "");
+    report(Outcome::Ok, "Contacts sorted alphabetically!");
+}
+
+// Wait until every change so far is written and synced to disk
+void flushContacts() {
+    if (wal.flush()) report(Outcome::Ok, "All changes are on disk!");
+    else report(Outcome::Error, "Failed to write " + STORE_FILE + ".wal!");
+}
+
+// Fixed-size worker pool; submit() hands back a future for the task's result
+class ThreadPool {
+private:
+    vector<thread> workers;
+    deque<function<void()>> tasks;
+    mutex queueMutex;
+    condition_variable wake;
+    bool stopping = false;
+
+public:
+    explicit ThreadPool(size_t threads) {
+        for (size_t i = 0; i < max<size_t>(1, threads); ++i) {
+            workers.emplace_back([this] {
+                while (true) {
+                    function<void()> task;
+                    {
+                        unique_lock<mutex> lock(queueMutex);
+                        wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+                        if (tasks.empty()) return;
+                        task = move(tasks.front());
+                        tasks.pop_front();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    size_t size() const { return workers.size(); }
+
+    template <typename Task>
+    auto submit(Task task) -> future<decltype(task())> {
+        auto packaged = make_shared<packaged_task<decltype(task())()>>(move(task));
+        {
+            lock_guard<mutex> lock(queueMutex);
+            tasks.emplace_back([packaged] { (*packaged)(); });
+        }
+        wake.notify_one();
+        return packaged->get_future();
+    }
+};
+
+// Rows parsed and validated from one chunk of an import file
+struct ImportBatch {
+    vector<array<string, 3>> rows; // name, phone, email
+    size_t invalid = 0;
+};
+
+// Apply add's defaults and validation to an imported row; phone punctuation such as
+// "+1 (555) 010-9999" is stripped down to its digits first
+bool acceptImportRow(array<string, 3>& row, ImportBatch& batch) {
+    row[1] = phoneDigits(row[1]);
+    for (auto& field : row) {
+        if (field.empty()) field = "-";
+    }
+    if (!isValidName(row[0]) || !isValidPhone(row[1]) || !isValidEmail(row[2])) {
+        ++batch.invalid;
+        return false;
+    }
+    batch.rows.push_back(move(row));
+    return true;
+}
+
+// CSV rows of name,phone,email; fields may be double-quoted with "" escapes but not span lines
+ImportBatch parseCsvChunk(const string& chunk, bool skipHeader) {
+    ImportBatch batch;
+    size_t lineStart = 0;
+    while (lineStart < chunk.size()) {
+        size_t lineEnd = chunk.find('\n', lineStart);
+        if (lineEnd == string::npos) lineEnd = chunk.size();
+        string_view line(chunk.data() + lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) continue;
+        if (skipHeader) { skipHeader = false; continue; }
+
+        array<string, 3> row;
+        size_t field = 0;
+        bool quoted = false;
+        for (size_t i = 0; i < line.size(); ++i) {
+            char c = line[i];
+            if (quoted) {
+                if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') row[field] += '"', ++i;
+                else if (c == '"') quoted = false;
+                else row[field] += c;
+            } else if (c == '"') {
+                quoted = true;
+            } else if (c == ',') {
+                if (++field == 3) break; // Extra columns are ignored
+            } else {
+                row[field] += c;
+            }
+        }
+        for (auto& value : row) { // Trim surrounding spaces
+            value.erase(0, value.find_first_not_of(' '));
+            value.erase(value.find_last_not_of(' ') + 1);
+        }
+        acceptImportRow(row, batch);
+    }
+    return batch;
+}
+
+// vCards: FN becomes the name, the first TEL and EMAIL the phone and email
+ImportBatch parseVcardChunk(const string& chunk) {
+    ImportBatch batch;
+    array<string, 3> row;
+    bool inCard = false;
+    size_t lineStart = 0;
+    while (lineStart < chunk.size()) {
+        size_t lineEnd = chunk.find('\n', lineStart);
+        if (lineEnd == string::npos) lineEnd = chunk.size();
+        string line = chunk.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        size_t colon = line.find(':');
+        if (colon == string::npos) continue;
+        string key = line.substr(0, min(colon, line.find(';')));
+        transform(key.begin(), key.end(), key.begin(), ::toupper);
+        string value = line.substr(colon + 1);
+        if (key == "BEGIN") { inCard = true; row = array<string, 3>(); }
+        else if (key == "END" && inCard) { inCard = false; acceptImportRow(row, batch); }
+        else if (key == "FN" && inCard) row[0] = value;
+        else if (key == "TEL" && inCard && row[1].empty()) row[1] = value;
+        else if (key == "EMAIL" && inCard && row[2].empty()) row[2] = value;
+    }
+    return batch;
+}
+
+// Whether text ends with suffix
+bool endsWith(string_view text, string_view suffix) {
+    return text.size() >= suffix.size() && text.substr(text.size() - suffix.size()) == suffix;
+}
+
+// Whether text has marker at pos, ignoring ASCII case; marker is upper case
+bool markerAt(string_view text, size_t pos, string_view marker) {
+    if (pos > text.size() || text.size() - pos < marker.size()) return false;
+    for (size_t i = 0; i < marker.size(); ++i) {
+        if (toupper(static_cast<unsigned char>(text[pos + i])) != marker[i]) return false;
+    }
+    return true;
+}
+
+// Offset just past the last END:VCARD line (in any case) of chunk, or npos
+size_t afterLastVcard(const string& chunk) {
+    size_t end = chunk.rfind('\n');
+    while (end != string::npos) {
+        size_t start = end > 0 ? chunk.rfind('\n', end - 1) : string::npos;
+        start = start == string::npos ? 0 : start + 1;
+        if (markerAt(chunk, start, "END:VCARD")) return end + 1;
+        if (start == 0) break;
+        end = start - 1;
+    }
+    return string::npos;
+}
+
+// Import contacts from a CSV or vCard file. The file is read in chunks that are parsed and
+// validated in parallel; rows are then added in file order, skipping names already in the
+// book, and the whole import is committed as a single write-ahead log record.
+void importContacts(ContactBook& contacts, const string& path) {
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) {
+        report(Outcome::Error, "Cannot open " + path + "!");
+        return;
+    }
+    auto start = chrono::steady_clock::now();
+    const size_t CHUNK_SIZE = 4 << 20;
+    string lowerPath = path;
+    transform(lowerPath.begin(), lowerPath.end(), lowerPath.begin(), ::tolower);
+    bool vcard = endsWith(lowerPath, ".vcf") || endsWith(lowerPath, ".vcard");
+
+    ThreadPool pool(thread::hardware_concurrency());
+    deque<future<ImportBatch>> pending;
+    string payload;
+    size_t added = 0, duplicates = 0, invalid = 0;
+    auto commit = [&](ImportBatch batch) {
+        invalid += batch.invalid;
+        for (const auto& row : batch.rows) {
+            if (hasDuplicateName(contacts, row[0])) { ++duplicates; continue; }
+            encodeContact(payload, contacts.add(Contact(row[0], row[1], row[2])));
+            ++added;
+        }
+    };
+
+    string carry;
+    bool firstChunk = true;
+    while (file || !carry.empty()) {
+        string chunk = move(carry);
+        carry.clear();
+        size_t previous = chunk.size();
+        chunk.resize(previous + CHUNK_SIZE);
+        file.read(&chunk[previous], CHUNK_SIZE);
+        chunk.resize(previous + file.gcount());
+        if (chunk.empty()) break;
+        if (firstChunk && !vcard && markerAt(chunk, 0, "BEGIN:VCARD")) vcard = true; // Before the first cut
+
+        if (file) { // Hand the incomplete last line (or vCard) over to the next chunk
+            size_t cut = vcard ? afterLastVcard(chunk) : chunk.rfind('\n');
+            if (cut == string::npos) { carry = move(chunk); continue; }
+            if (!vcard) ++cut;
+            carry = chunk.substr(cut);
+            chunk.resize(cut);
+        }
+        bool skipHeader = false;
+        if (firstChunk && !vcard) { // A first line naming the columns is a header
+            string firstLine = chunk.substr(0, chunk.find('\n'));
+            transform(firstLine.begin(), firstLine.end(), firstLine.begin(), ::tolower);
+            skipHeader = firstLine.find("name") != string::npos && firstLine.find("phone") != string::npos;
+        }
+        firstChunk = false;
+
+        pending.push_back(pool.submit([chunk = move(chunk), vcard, skipHeader] {
+            return vcard ? parseVcardChunk(chunk) : parseCsvChunk(chunk, skipHeader);
+        }));
+        if (pending.size() >= 2 * pool.size()) { // Bound the chunks held in memory
+            commit(pending.front().get());
+            pending.pop_front();
+        }
+    }
+    for (; !pending.empty(); pending.pop_front()) commit(pending.front().get());
+
+    if (added > 0) logMutation(contacts, WalOp::Import, payload);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    char elapsed[32];
+    snprintf(elapsed, sizeof(elapsed), "%.2fs", seconds);
+    report(Outcome::Ok, "Imported " + to_string(added) + " contacts",
+           " (" + to_string(duplicates) + " duplicate names, " + to_string(invalid) + " invalid rows) in " + elapsed);
+}
+
+// Export formats. "-" placeholders are written as empty CSV fields, JSON nulls and missing vCard
+// properties, so an exported CSV or vCard imports back unchanged.
+void appendCsvField(string& out, string_view value) {
+    if (value == "-") return;
+    if (value.find_first_of(",\"\r\n") == string_view::npos) { out.append(value.data(), value.size()); return; }
+    out += '"';
+    for (char c : value) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+// Stream the book to a CSV, JSON or vCard file without building the whole output in memory
+void exportContacts(const ContactBook& contacts, const string& path, string format) {
+    if (format.empty()) { // Pick the format from the extension, CSV by default
+        string lowerPath = path;
+        transform(lowerPath.begin(), lowerPath.end(), lowerPath.begin(), ::tolower);
+        format = endsWith(lowerPath, ".json") ? "json" : endsWith(lowerPath, ".vcf") ? "vcard" : "csv";
+    }
+    transform(format.begin(), format.end(), format.begin(), ::tolower);
+    if (format != "csv" && format != "json" && format != "vcard") {
+        report(Outcome::Error, "Unknown export format '" + format + "'! Use csv, json or vcard.");
+        return;
+    }
+    FileWriter file;
+    if (!file.open(path)) {
+        report(Outcome::Error, "Cannot create " + path + "!");
+        return;
+    }
+
+    auto start = chrono::steady_clock::now();
+    string record; // Reused for every contact
+    bool first = true;
+    if (format == "csv") file.append("name,phone,email\n");
+    else if (format == "json") file.append("[");
+    contacts.forEach([&](const Contact& contact) {
+        record.clear();
+        if (format == "csv") {
+            appendCsvField(record, contact.getName());
+            record += ',';
+            appendCsvField(record, contact.getPhone());
+            record += ',';
+            appendCsvField(record, contact.getEmail());
+            record += '\n';
+        } else if (format == "json") {
+            record += first ? "\n  {\"name\": " : ",\n  {\"name\": ";
+            appendJsonString(record, contact.getName());
+            record += ", \"phone\": ";
+            appendJsonString(record, contact.getPhone());
+            record += ", \"email\": ";
+            appendJsonString(record, contact.getEmail());
+            record += '}';
+        } else {
+            record += "BEGIN:VCARD\r\nVERSION:3.0\r\n";
+            for (auto [key, value] : { make_pair("FN:", contact.getName()), make_pair("TEL:", contact.getPhone()), make_pair("EMAIL:", contact.getEmail()) }) {
+                if (value == "-") continue;
+                record += key;
+                record.append(value.data(), value.size());
+                record += "\r\n";
+            }
+            record += "END:VCARD\r\n";
+        }
+        first = false;
+        file.append(record);
+    });
+    if (format == "json") file.append(first ? "]\n" : "\n]\n");
+
+    if (!file.close()) {
+        report(Outcome::Error, "Failed to write " + path + "!");
+        return;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    char elapsed[32];
+    snprintf(elapsed, sizeof(elapsed), "%.2fs", seconds);
+    report(Outcome::Ok, "Exported " + to_string(contacts.size()) + " contacts to " + path, " (" + format + ") in " + elapsed);
+}
+
+// Compare the columnar ContactTable against vector<Contact>: memory footprint and scan throughput
+void compareTableLayout(const ContactBook& contacts) {
+    vector<Contact> rows = contacts.snapshot();
+    size_t nameBytes = 0, phoneBytes = 0, emailBytes = 0, longFieldBytes = 0;
+    for (const auto& contact : rows) {
+        nameBytes += contact.getName().size();
+        phoneBytes += contact.getPhone().size();
+        emailBytes += contact.getEmail().size();
+        for (string_view field : { contact.getName(), contact.getPhone(), contact.getEmail() }) {
+            if (field.size() > 15) longFieldBytes += (field.size() + 16) / 16 * 16; // Beyond libstdc++'s SSO buffer
+        }
+    }
+    ContactTable table;
+    table.reserve(rows.size(), nameBytes, phoneBytes, emailBytes);
+    for (const auto& contact : rows) table.add(contact.getName(), contact.getPhone(), contact.getEmail());
+    size_t fieldBytes = nameBytes + phoneBytes + emailBytes;
+    size_t rowBytes = rows.capacity() * sizeof(Contact) + fieldBytes;
+    size_t stringBytes = rows.size() * 3 * sizeof(string) + longFieldBytes;
+
+    // Sample queries: a trigram from evenly spaced names, plus one that never matches
+    vector<string> queries;
+    for (size_t i = 0; i < rows.size() && queries.size() < 8; i += max<size_t>(1, rows.size() / 8)) {
+        string_view name = rows[i].getName();
+        if (name.size() >= 3) queries.emplace_back(name.substr(name.size() / 2 - 1, 3));
+    }
+    queries.push_back("\x01\x02\x03");
+
+    size_t rowHits = 0, tableHits = 0;
+    auto start = chrono::steady_clock::now();
+    for (const auto& query : queries) {
+        for (const auto& contact : rows) {
+            if (findIn(contact.getName(), query) != NOT_FOUND || findIn(contact.getPhone(), query) != NOT_FOUND ||
+                findIn(contact.getEmail(), query) != NOT_FOUND) ++rowHits;
+        }
+    }
+    auto middle = chrono::steady_clock::now();
+    for (const auto& query : queries) table.search(query, [&tableHits](const Contact&) { ++tableHits; });
+    auto end = chrono::steady_clock::now();
+
+    double scanned = static_cast<double>(fieldBytes) * queries.size() / (1024.0 * 1024.0);
+    double rowSeconds = max(1e-9, chrono::duration<double>(middle - start).count());
+    double tableSeconds = max(1e-9, chrono::duration<double>(end - middle).count());
+
+    setColor(CYAN); term << "\nLayout comparison over " << rows.size() << " contacts, " << queries.size() << " scan queries (" << scan.level << " kernels)\n";
+    setColor(WHITE);
+    term << terminal::pad("  Layout", 40) << terminal::pad("Memory (KiB)", 16) << "Scan (MiB/s)\n";
+    term << terminal::pad("  vector<Contact> (string_view)", 40) << terminal::pad(to_string(rowBytes / 1024), 16) << terminal::fixed(scanned / rowSeconds, 1) << "\n";
+    term << terminal::pad("  vector<Contact> (std::string, est.)", 40) << terminal::pad(to_string(stringBytes / 1024), 16) << "-\n";
+    term << terminal::pad("  ContactTable (columnar)", 40) << terminal::pad(to_string(table.memoryBytes() / 1024), 16) << terminal::fixed(scanned / tableSeconds, 1) << "\n";
+    if (rowHits != tableHits) { setColor(RED); term << "Warning: layouts disagree on matches (" << rowHits << " vs " << tableHits << ")\n"; }
+    setColor(WHITE);
+}
+
+// Compare the size of the book in both store layouts. With a name, also fetch that contact from a
+// block-compressed snapshot on disk, decoding only the block that holds it.
+void storeStats(const ContactBook& contacts, const string& name) {
+    vector<Contact> rows = contacts.snapshot();
+    size_t plainBytes = STORE_HEADER_SIZE, blockBytes = 0;
+    for (const auto& contact : rows) {
+        plainBytes += RECORD_HEADER_SIZE + contact.getName().size() + contact.getPhone().size() + contact.getEmail().size();
+    }
+    BlockStore::encode(rows, 0, [&blockBytes](string_view bytes) { blockBytes += bytes.size(); });
+    size_t perContact = max<size_t>(1, rows.size());
+
+    error_code ec;
+    uint64_t diskBytes = filesystem::file_size(STORE_FILE, ec);
+    MappedFile file;
+    BlockStore store;
+    bool blocks = !ec && file.open(STORE_FILE) && store.parse(file.view());
+
+    setColor(CYAN); term << "\nStore layouts for " << rows.size() << " contacts\n"; setColor(WHITE);
+    term << terminal::pad("  Layout", 28) << terminal::pad("Size (KiB)", 14) << "Bytes/contact\n";
+    term << terminal::pad("  Plain records", 28) << terminal::pad(to_string(plainBytes / 1024), 14) << terminal::fixed(static_cast<double>(plainBytes) / perContact, 1) << "\n";
+    term << terminal::pad("  Compressed blocks", 28) << terminal::pad(to_string(blockBytes / 1024), 14) << terminal::fixed(static_cast<double>(blockBytes) / perContact, 1)
+         << "  (" << terminal::fixed(static_cast<double>(plainBytes) / max<size_t>(1, blockBytes), 1) << "x smaller)\n";
+    setColor(LIGHT_GRAY);
+    term << STORE_FILE << ": " << (ec ? string("not written yet") : to_string(diskBytes / 1024) + " KiB, " + (blocks ? "compressed blocks" : "plain records"));
+    if (blocks) term << " (" << store.blockCount() << " blocks, " << store.domainCount() << " email domains)";
+    term << "\n";
+    setColor(WHITE);
+    if (name.empty()) return;
+    if (!blocks) {
+        report(Outcome::Warning, "Lookups straight from disk need a compressed store (--store-format=blocks)");
+        return;
+    }
+
+    bool found = false;
+    auto start = chrono::steady_clock::now();
+    size_t decoded = store.find(name, [&found](string_view n, string_view p, string_view e) {
+        found = true;
+        setColor(GREEN); term << n << " - " << p << " - " << e << '\n'; setColor(WHITE);
+    });
+    double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    if (!found) report(Outcome::Warning, "No contact named '" + name + "' in the last snapshot");
+    setColor(LIGHT_GRAY);
+    term << "Decoded " << decoded << " of " << store.blockCount() << " blocks in " << terminal::fixed(micros, 1) << " us\n";
+    setColor(WHITE);
+}
+
+// Read throughput of ConcurrentBook against one ContactBook behind a shared_mutex, for 1, 2, 4, ...
+// up to maxReaders searching threads while one writer keeps adding and deleting a contact
+void benchmarkConcurrentReads(const ContactBook& contacts, size_t maxReaders, int milliseconds) {
+    vector<Contact> rows = contacts.snapshot();
+    mt19937 rng(20250220);
+    for (size_t i = rows.size(); i < 10000; ++i) { // Pad small books with random names
+        string name(5 + rng() % 10, 'a');
+        for (auto& c : name) c = 'a' + rng() % 26;
+        rows.emplace_back(name, to_string(1000000000ULL + i), name + "@bench.com");
+    }
+    vector<string> queries; // Trigrams from random names
+    for (size_t i = 0; i < 256; ++i) {
+        string_view name = rows[rng() % rows.size()].getName();
+        if (name.size() >= 3) queries.emplace_back(name.substr(rng() % (name.size() - 2), 3));
+    }
+    if (queries.empty()) queries.push_back("abc");
+
+    ContactBook published{ vector<Contact>(rows) };
+    ConcurrentBook shared(published);
+    ContactBook locked{ vector<Contact>(rows) };
+    locked.buildIndexes();
+    shared_mutex lock;
+
+    // Run readers threads plus the writer for the given time; returns reads and writes per second
+    auto measure = [&](size_t readers, bool useLock) {
+        atomic<bool> stop{false};
+        atomic<size_t> reads{0};
+        size_t writes = 0;
+        vector<thread> threads;
+        for (size_t r = 0; r < readers; ++r) {
+            threads.emplace_back([&, r] {
+                size_t done = 0, hits = 0;
+                for (size_t i = r; !stop.load(memory_order_relaxed); ++i) {
+                    const string& query = queries[i % queries.size()];
+                    auto count = [&hits, &query](const ContactBook& book) { book.search(query, [&hits](const Contact&) { ++hits; }); return 0; };
+                    if (useLock) {
+                        shared_lock<shared_mutex> guard(lock);
+                        count(locked);
+                    } else {
+                        shared.read(count);
+                    }
+                    ++done;
+                }
+                reads += done + (hits == SIZE_MAX); // Keep the searches observable
+            });
+        }
+        thread writer([&] {
+            Contact extra("Concurrent Writer", "1999999999", "writer@bench.com");
+            for (bool adding = true; !stop.load(memory_order_relaxed); adding = !adding, ++writes) {
+                auto change = [&](ContactBook& book) { return adding ? (book.add(extra), true) : book.removeMatching(extra.getName()); };
+                if (useLock) {
+                    unique_lock<shared_mutex> guard(lock);
+                    change(locked);
+                } else {
+                    shared.write(change, [&change](ContactBook& book, bool) { change(book); });
+                }
+            }
+        });
+        this_thread::sleep_for(chrono::milliseconds(milliseconds));
+        stop = true;
+        for (auto& t : threads) t.join();
+        writer.join();
+        double seconds = milliseconds / 1000.0;
+        return make_pair(reads.load() / seconds, writes / seconds);
+    };
+
+    setColor(CYAN); term << "\nConcurrent reads over " << rows.size() << " contacts, one writer, " << milliseconds << " ms per run ("
+                         << thread::hardware_concurrency() << " hardware threads)\n";
+    setColor(WHITE);
+    term << "  " << terminal::pad("Readers", 9) << terminal::pad("left-right reads/s", 20) << terminal::pad("writes/s", 12)
+         << terminal::pad("shared_mutex reads/s", 22) << "writes/s\n";
+    for (size_t readers = 1; readers <= maxReaders; readers *= 2) {
+        auto free = measure(readers, false);
+        auto guarded = measure(readers, true);
+        term << "  " << terminal::pad(to_string(readers), 9) << terminal::fixed(free.first, 0, 20) << terminal::fixed(free.second, 0, 12)
+             << terminal::fixed(guarded.first, 0, 22) << terminal::fixed(guarded.second, 0) << "\n";
+        term.flush();
+    }
+}
+
+// Time the sharded scan with 1, 2, 4, ... up to maxThreads threads, checking that book order and
+// name order results match a single-threaded scan. Small books are padded to 200000 contacts.
+void benchmarkParallelSearch(const ContactBook& contacts, string query, size_t maxThreads) {
+    vector<Contact> rows = contacts.snapshot();
+    mt19937 rng(20250220);
+    for (size_t i = rows.size(); i < 200000; ++i) {
+        string name(5 + rng() % 10, 'a');
+        for (auto& c : name) c = 'a' + rng() % 26;
+        rows.emplace_back(name, to_string(1000000000ULL + i), name + "@bench.com");
+    }
+    ContactBook book{ move(rows) };
+    if (query.empty()) query = "ab";
+
+    vector<const Contact*> expected, expectedByName;
+    book.search(query, [&expected](const Contact& contact) { expected.push_back(&contact); });
+    expectedByName = expected;
+    stable_sort(expectedByName.begin(), expectedByName.end(), [](const Contact* a, const Contact* b) { return a->getName() < b->getName(); });
+
+    setColor(CYAN); term << "\nSharded scan for \"" << query << "\" over " << book.size() << " contacts, " << expected.size() << " matches ("
+                         << thread::hardware_concurrency() << " hardware threads)\n";
+    setColor(WHITE);
+    term << "  " << terminal::pad("Threads", 9) << terminal::pad("ms/search", 12) << terminal::pad("speedup", 10) << "results\n";
+    double single = 0;
+    for (size_t threads = 1;; threads = min(threads * 2, maxThreads)) {
+        WorkStealingPool pool(threads);
+        vector<const Contact*> got, gotByName;
+        book.parallelScan(query, pool, false, [&got](const Contact& contact) { got.push_back(&contact); });
+        book.parallelScan(query, pool, true, [&gotByName](const Contact& contact) { gotByName.push_back(&contact); });
+
+        size_t runs = 0;
+        auto start = chrono::steady_clock::now();
+        double elapsed = 0;
+        size_t hits = 0;
+        while (elapsed < 0.3 || runs < 3) {
+            book.parallelScan(query, pool, false, [&hits](const Contact&) { ++hits; });
+            ++runs;
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        }
+        double ms = elapsed * 1000 / runs;
+        if (threads == 1) single = ms;
+        term << "  " << terminal::pad(to_string(threads), 9) << terminal::fixed(ms, 3, 12) << terminal::fixed(single / ms, 2, 10);
+        bool same = got == expected && gotByName == expectedByName && hits == runs * expected.size();
+        setColor(same ? GREEN : RED); term << (same ? "match\n" : "MISMATCH\n"); setColor(WHITE);
+        term.flush();
+        if (threads >= maxThreads) break;
+    }
+}
+
+#endif // CUSTOM_PHONEBOOK_H
@@ -0,0 +1,220 @@
+/**
+ * terminal.h
+ *
+ * Buffered, color-aware terminal output shared by the C++ console applications.
+ *
+ * Output is collected in one large buffer and handed to the terminal with a single
+ * write(2) when flushed (before reading input, before clearing the screen, or once the
+ * buffer passes 1 MiB). Color changes are applied lazily: only the state in effect when
+ * text is actually written is sent, so back-to-back or repeated color requests cost
+ * nothing. When stdout is not a terminal (or NO_COLOR is set) color requests are dropped
+ * entirely, which keeps piped output free of escape codes.
+ *
+ * Author: Upendra237
+ * License: MIT
+ */
+
+#ifndef CUSTOM_TERMINAL_H
+#define CUSTOM_TERMINAL_H
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <io.h>
+    #ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+        #define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+    #endif
+#else
+    #include <cerrno>
+    #include <unistd.h>
+#endif
+
+namespace terminal {
+
+/**
+ * Foreground colors; the value is the ANSI SGR code
+ */
+enum class Color : unsigned char {
+    Default = 39,
+    Red = 31,
+    Green = 32,
+    Yellow = 33,
+    Blue = 34,
+    Magenta = 35,
+    Cyan = 36,
+    White = 37,
+    Gray = 90,
+    LightCyan = 96
+};
+
+/**
+ * Text attributes: Reset clears color and bold, Bold turns bold on
+ */
+enum class Style : unsigned char { Reset = 0, Bold = 1 };
+
+/**
+ * Left-aligned text padded with spaces to at least `width` columns (like left << setw)
+ */
+struct Padded {
+    std::string_view text;
+    size_t width;
+};
+inline Padded pad(std::string_view text, size_t width) { return Padded{ text, width }; }
+
+/**
+ * A number printed with a fixed count of decimals, optionally padded (like fixed << setprecision)
+ */
+struct Fixed {
+    double value;
+    int precision;
+    size_t width;
+};
+inline Fixed fixed(double value, int precision, size_t width = 0) { return Fixed{ value, precision, width }; }
+
+class Output {
+private:
+    static constexpr size_t FLUSH_THRESHOLD = 1 << 20;
+    std::string buffer;
+    Color color = Color::Default; // Requested state
+    bool bold = false;
+    Color sentColor = Color::Default; // State the terminal is actually in
+    bool sentBold = false;
+    bool colors = false;
+
+    static bool detectColorSupport() {
+        if (std::getenv("NO_COLOR")) return false;
+#ifdef _WIN32
+        if (!_isatty(_fileno(stdout))) return false;
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+        return GetConsoleMode(console, &mode) && SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#else
+        return isatty(STDOUT_FILENO);
+#endif
+    }
+
+    void sgr(unsigned code) {
+        if (!colors) return;
+        buffer += "\033[";
+        buffer += std::to_string(code);
+        buffer += 'm';
+    }
+
+    // Emit the escape codes needed to move the terminal from the sent state to the requested one
+    void sync() {
+        if (!colors) return;
+        if (sentBold && !bold) {
+            sgr(0);
+            sentBold = false;
+            sentColor = Color::Default;
+        }
+        if (bold && !sentBold) {
+            sgr(1);
+            sentBold = true;
+        }
+        if (color != sentColor) {
+            sgr(static_cast<unsigned>(color));
+            sentColor = color;
+        }
+    }
+
+    void append(std::string_view text) {
+        if (text.find_first_not_of('\n') != std::string_view::npos) sync(); // A bare newline shows no color
+        buffer.append(text.data(), text.size());
+        if (buffer.size() >= FLUSH_THRESHOLD) flush();
+    }
+
+public:
+    Output() : colors(detectColorSupport()) { buffer.reserve(64 * 1024); }
+    Output(const Output&) = delete;
+    Output& operator=(const Output&) = delete;
+    ~Output() {
+        *this << Style::Reset;
+        flush();
+    }
+
+    bool colorEnabled() const { return colors; }
+    void setColorEnabled(bool enabled) { colors = enabled; }
+
+    /**
+     * Write everything buffered so far with a single system call; the requested color is
+     * applied first so that echoed input appears in it
+     */
+    void flush() {
+        sync();
+        if (buffer.empty()) return;
+#ifdef _WIN32
+        fwrite(buffer.data(), 1, buffer.size(), stdout);
+        fflush(stdout);
+#else
+        size_t done = 0;
+        while (done < buffer.size()) {
+            ssize_t written = ::write(STDOUT_FILENO, buffer.data() + done, buffer.size() - done);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) break;
+            done += written;
+        }
+#endif
+        buffer.clear();
+    }
+
+    Output& operator<<(Color next) {
+        color = next;
+        return *this;
+    }
+
+    Output& operator<<(Style style) {
+        if (style == Style::Bold) {
+            bold = true;
+        } else {
+            bold = false;
+            color = Color::Default;
+        }
+        return *this;
+    }
+
+    Output& operator<<(std::string_view text) { append(text); return *this; }
+    Output& operator<<(const std::string& text) { append(text); return *this; }
+    Output& operator<<(const char* text) { append(text); return *this; }
+    Output& operator<<(char c) { append(std::string_view(&c, 1)); return *this; }
+
+    template <typename Integer, typename = std::enable_if_t<std::is_integral_v<Integer> && !std::is_same_v<Integer, char> && !std::is_same_v<Integer, bool>>>
+    Output& operator<<(Integer value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        append(std::string_view(digits, result.ptr - digits));
+        return *this;
+    }
+
+    Output& operator<<(const Padded& padded) {
+        append(padded.text);
+        if (padded.text.size() < padded.width) buffer.append(padded.width - padded.text.size(), ' ');
+        return *this;
+    }
+
+    Output& operator<<(const Fixed& number) {
+        char text[64];
+        int length = snprintf(text, sizeof(text), "%.*f", number.precision, number.value);
+        if (length < 0) length = 0;
+        if (length >= static_cast<int>(sizeof(text))) length = sizeof(text) - 1;
+        return *this << pad(std::string_view(text, length), number.width);
+    }
+};
+
+/**
+ * The process-wide stdout writer; flushed automatically at exit
+ */
+inline Output& out() {
+    static Output output;
+    return output;
+}
+
+} // namespace terminal
+
+#endif // CUSTOM_TERMINAL_H